@@ -0,0 +1,112 @@
+#!/bin/sh
+# compiles and runs every program in bench/programs (and one generated by
+# gen.awk) a few times, checks what they print, and sums up how long it all
+# took.
+#
+# usage: bench/bench.sh [budgie]
+#
+# RUNS is how many times to compile and run each program (default 5), and
+# BUDGIE_FLAGS is passed to every compile, so the same programs can be timed
+# with different options.
+#
+# a program's expected output is in <name>.out, or for big outputs, just its
+# cksum in <name>.sum. if <name>.in exists it is the program's input.
+
+BUDGIE=${1:-./budgie}
+RUNS=${RUNS:-5}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+# nanoseconds since the epoch (needs gnu date)
+now() {
+    date +%s%N
+}
+
+# min, median, mean and standard deviation of the numbers on stdin, in ms
+summary() {
+    sort -n | awk '
+        { v[NR] = $1 / 1e6; sum += v[NR] }
+        END {
+            mean = sum / NR
+            for (i = 1; i <= NR; i++) var += (v[i] - mean) ^ 2
+            med = NR % 2 ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2
+            sd = NR > 1 ? sqrt(var / (NR - 1)) : 0
+            printf "%9.2f %9.2f %9.2f %8.2f", v[1], med, mean, sd
+        }'
+}
+
+# check the output of a program against what it should be
+check() {
+    if [ -f "$DIR/programs/$1.out" ]; then
+        cmp -s "$2" "$DIR/programs/$1.out"
+    elif [ -f "$DIR/programs/$1.sum" ]; then
+        [ "$(cksum < "$2" | cut -d' ' -f1,2)" = "$(cat "$DIR/programs/$1.sum")" ]
+    else
+        echo "$1: nothing to check the output against" >&2
+        return 1
+    fi
+}
+
+if [ ! -x "$BUDGIE" ]; then
+    echo "$BUDGIE isn't there; build it first" >&2
+    exit 1
+fi
+
+awk -f "$DIR/gen.awk" > "$TMP/gen.b"
+
+printf '%-10s %9s %9s %9s | %-37s | %-37s | %s\n' "" "source" "ir" "binary" \
+    "           compile (ms)" "             run (ms)" ""
+printf '%-10s %9s %9s %9s | %9s %9s %9s %8s | %9s %9s %9s %8s | %s\n' "program" \
+    "bytes" "ops" "bytes" "min" "median" "mean" "sd" "min" "median" "mean" "sd" "output"
+
+failed=0
+for prog in "$DIR"/programs/*.b "$TMP/gen.b"; do
+    name=$(basename "$prog" .b)
+    bin="$TMP/$name"
+    input=/dev/null
+    [ -f "$DIR/programs/$name.in" ] && input="$DIR/programs/$name.in"
+
+    # compile it
+    : > "$TMP/compile"
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(now)
+        # shellcheck disable=SC2086
+        if ! "$BUDGIE" $BUDGIE_FLAGS --input="$prog" > "$bin"; then
+            echo "$name: compile failed" >&2
+            failed=1
+            continue 2
+        fi
+        echo $(($(now) - start)) >> "$TMP/compile"
+        i=$((i + 1))
+    done
+    chmod +x "$bin"
+
+    # how many ops are left after optimizing, from --stats
+    # shellcheck disable=SC2086
+    ops=$("$BUDGIE" $BUDGIE_FLAGS --stats=json --input="$prog" 2>&1 > /dev/null |
+          sed -n 's/.*"after":{"ops":\([0-9]*\).*/\1/p')
+
+    # and run it
+    : > "$TMP/run"
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(now)
+        "$bin" < "$input" > "$TMP/output"
+        echo $(($(now) - start)) >> "$TMP/run"
+        i=$((i + 1))
+    done
+
+    if check "$name" "$TMP/output"; then
+        result=ok
+    else
+        result=WRONG
+        failed=1
+    fi
+
+    printf '%-10s %9d %9s %9d | %s | %s | %s\n' "$name" "$(wc -c < "$prog")" "$ops" \
+        "$(wc -c < "$bin")" "$(summary < "$TMP/compile")" "$(summary < "$TMP/run")" "$result"
+done
+
+exit $failed
@@ -0,0 +1,39 @@
+# generates a large brainfuck program, to see how budgie copes with big
+# inputs. the program is made of <blocks> small pieces (default 40000) of
+# the kind real programs are made of: runs of arithmetic, multiplication
+# loops, clears, scans and output. the pieces are picked by a fixed
+# pseudo-random sequence, so the program (and what it prints) is always the
+# same.
+#
+# usage: awk -v blocks=<n> -f gen.awk > gen.b
+
+function rnd(n) {
+    # zx81's generator; the numbers stay small enough that awk's doubles
+    # never round
+    seed = (seed * 75 + 74) % 65537
+    return seed % n
+}
+
+function rep(s, n,    out) {
+    out = ""
+    while (n-- > 0) out = out s
+    return out
+}
+
+BEGIN {
+    if (!blocks) blocks = 40000
+    seed = 1
+    for (i = 0; i < blocks; i++) {
+        # every piece starts and ends on cell 0 with cells 0 to 3 clear
+        a = rnd(15) + 1
+        b = rnd(15) + 1
+        line = rep("+", a) "[>" rep("+", b) ">" rep("-", rnd(5) + 1) "<<-]"
+        k = rnd(4)
+        if (k == 0) line = line ">[>+>+<<-]>>[<<+>>-]<[-]<<"
+        else if (k == 1) line = line ">[-]+>[-]+>[-]<<<>[>]<[<]"
+        else if (k == 2) line = line ">" rep("+", rnd(9)) "<"
+        if (rnd(3) == 0) line = line ">.<"
+        line = line ">[-]>[-]>[-]<<<"
+        print line
+    }
+}
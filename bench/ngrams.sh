@@ -0,0 +1,41 @@
+#!/bin/sh
+# counts the runs of IR ops that come up most in a set of programs once
+# they're optimized, to see which ones are worth translating together as an
+# idiom.
+#
+# usage: bench/ngrams.sh [budgie] [programs...]
+#
+# N is how many ops in a row to count (default 2, at most 4) and TOP how many
+# of the most common runs to print (default 20). without any programs, it
+# counts the ones in bench/programs and one generated by gen.awk.
+# BUDGIE_FLAGS is passed to every compile, since optimizer options change the
+# ops a program ends up with.
+
+BUDGIE=${1:-./budgie}
+[ $# -gt 0 ] && shift
+N=${N:-2}
+TOP=${TOP:-20}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+if [ ! -x "$BUDGIE" ]; then
+    echo "$BUDGIE isn't there; build it first" >&2
+    exit 1
+fi
+
+if [ $# -eq 0 ]; then
+    awk -f "$DIR/gen.awk" > "$TMP/gen.b"
+    set -- "$DIR"/programs/*.b "$TMP/gen.b"
+fi
+
+for prog in "$@"; do
+    # shellcheck disable=SC2086
+    "$BUDGIE" $BUDGIE_FLAGS --ngrams="$N" --input="$prog" || echo "$prog: failed" >&2
+done > "$TMP/counts"
+
+# add up the counts of each run over all the programs
+awk '
+    { n = $1; $1 = ""; count[substr($0, 2)] += n; total += n }
+    END { for (k in count) printf "%d %.2f%% %s\n", count[k], 100 * count[k] / total, k }
+' "$TMP/counts" | sort -k1,1nr -k3 | head -n "$TOP"
@@ -0,0 +1,171 @@
+bottles: the lyrics of 99 bottles of beer
+
+an output heavy workload made of lots of short loops: every number is
+printed in decimal with a divide by ten done one unit at a time
+
+[-]+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++[>>>>>>>>>>>>>>>>[-]+>[-]<<<<<<<<<<<<<<[-]<<<[->>>
+>>>>>>>>>>>>>>+<<<<<<<<<<<<<<+<<<]>>>[-<<<+>>>]>>>>>>>>>>>>>>[<[-]<<<<<<<<<<
+<<<<<[-]>>[-]<<<[->+>>+<<<]>>>[-<<<+>>>]>>>>[-]++++++++++<<[-]>[-]<<<<<[->>>
+>>>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++<<+>>>
+>>[-]]<<<<<<<<<]>>>>>++++++++++>[-<->][-]++++++++++>>>>[-]>[-]<<<<<<<[->>->>
+>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++>>>>+<[-]]<<
+<<<]>>>>>>>++++++++++<<<<<[->>>>>-<<<<<]>>>>>>[-]<<<<<[-]>[-]>>[-<<<+>+>>]<<
+[->>+<<]<[>>>>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>>>>[->+<<<<<+>>>>]<<<<[->>>>+<<<<
+]<[-]>[-]>>>[-<<<<+>+>>>]<<<[->>>+<<<]<[>>>>>>[-]+<<<<<<[-]]>>>>>[<<++++++++
+++++++++++++++++++++++++++++++++++++++++.>>[-]]<<[-]>>>[<<++++++++++++++++++
+++++++++++++++++++++++++++++++.>>[-]]<<[-]<<<<<<++++++++++++++++++++++++++++
+++++++++++++++++++++.[-]<<[-]++++++++++++++++++++++++++++++++.++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++++.+++++..--
+------.-------.[-]<<[-]>[-]<<<[->>+>+<<<]>>>[-<<<+>>>]<-[>>[-]++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++.[-]<<[-]]>>>>>>>>>>>>>>>[-]]<[<<<<<<<<<<<<[-][-]>>
+>>>>>>>>>>[-]]<<<<<<<<<<<<[-]++++++++++++++++++++++++++++++++.++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.---------.
+----------------------------------------------------------------------.+++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++..+++++++++
+++++.-----------------------------------------------------------------------
+-----------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++.-.----------------------------------------------------------
+--------------------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++.------------.---.-----------------------------
+----------------------------------------.+++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++.----------------------.
++++++++++++..---------------------------------------------------------------
+-.------------.[-]>>>>>>>>>>>>[-]+>[-]<<<<<<<<<<<<<<[-]<<<[->>>>>>>>>>>>>>>>
+>+<<<<<<<<<<<<<<+<<<]>>>[-<<<+>>>]>>>>>>>>>>>>>>[<[-]<<<<<<<<<<<<<<<[-]>>[-]
+<<<[->+>>+<<<]>>>[-<<<+>>>]>>>>[-]++++++++++<<[-]>[-]<<<<<[->>>>>>->>>[-]+<<
+[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++<<+>>>>>[-]]<<<<<<<
+<<]>>>>>++++++++++>[-<->][-]++++++++++>>>>[-]>[-]<<<<<<<[->>->>>[-]+<<[-]>[-
+]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++>>>>+<[-]]<<<<<]>>>>>>>++
+++++++++<<<<<[->>>>>-<<<<<]>>>>>>[-]<<<<<[-]>[-]>>[-<<<+>+>>]<<[->>+<<]<[>>>
+>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>>>>[->+<<<<<+>>>>]<<<<[->>>>+<<<<]<[-]>[-]>>>[
+-<<<<+>+>>>]<<<[->>>+<<<]<[>>>>>>[-]+<<<<<<[-]]>>>>>[<<+++++++++++++++++++++
++++++++++++++++++++++++++++.>>[-]]<<[-]>>>[<<+++++++++++++++++++++++++++++++
++++++++++++++++++.>>[-]]<<[-]<<<<<<+++++++++++++++++++++++++++++++++++++++++
++++++++.[-]<<[-]++++++++++++++++++++++++++++++++.+++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++.+++++++++++++.+++++..--------.------
+-.[-]<<[-]>[-]<<<[->>+>+<<<]>>>[-<<<+>>>]<-[>>[-]+++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++.[-]<<[-]]>>>>>>>>>>>>>>>[-]]<[<<<<<<<<<<<<[-][-]>>>>>>>>>>>>[-]
+]<<<<<<<<<<<<[-]++++++++++++++++++++++++++++++++.+++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++.---------.-------------
+---------------------------------------------------------.++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++.+++..+++++++++++++.--------
+------------------------------------------------------------.---------------
+---------------------.++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++.+++++++++++++.++++++++++.------.-----------------------
+----------------------------------------------.+++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++.-.---------.-------------
+--------------------------------------------------------.+++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++.++++++++.-----
+----.-----------------------------------------------------------------------
+-------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++
++++++++++++.----------.-----------------------------------------------------
+---------------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++.---------------.++++++++++++++++++..-------------------
+----------------------------------------------------------------.+++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++.-
+----------------------------------------------------------------------------
+-------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++
++++++++++++++++.---.++++++.-------.----------.------------------------------
+--------------------------.------------.[-]<<<<->>>>>>>>>>>>>>>>[-]+>[-]<<<<
+<<<<<<<<<<[-]<<<[->>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<+<<<]>>>[-<<<+>>>]>>>>>>>>
+>>>>>>[<[-]<<<<<<<<<<<<<<<[-]>>[-]<<<[->+>>+<<<]>>>[-<<<+>>>]>>>>[-]++++++++
+++<<[-]>[-]<<<<<[->>>>>>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>
+>[<<<++++++++++<<+>>>>>[-]]<<<<<<<<<]>>>>>++++++++++>[-<->][-]++++++++++>>>>
+[-]>[-]<<<<<<<[->>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<+
++++++++++>>>>+<[-]]<<<<<]>>>>>>>++++++++++<<<<<[->>>>>-<<<<<]>>>>>>[-]<<<<<[
+-]>[-]>>[-<<<+>+>>]<<[->>+<<]<[>>>>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>>>>[->+<<<<<
++>>>>]<<<<[->>>>+<<<<]<[-]>[-]>>>[-<<<<+>+>>>]<<<[->>>+<<<]<[>>>>>>[-]+<<<<<
+<[-]]>>>>>[<<++++++++++++++++++++++++++++++++++++++++++++++++.>>[-]]<<[-]>>>
+[<<++++++++++++++++++++++++++++++++++++++++++++++++.>>[-]]<<[-]<<<<<<+++++++
++++++++++++++++++++++++++++++++++++++++++.[-]<<[-]++++++++++++++++++++++++++
+++++++.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++
++++++++++++.+++++..--------.-------.[-]<<[-]>[-]<<<[->>+>+<<<]>>>[-<<<+>>>]<
+-[>>[-]+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++.[-]<<[-]]>>>>>>>>>>>>>>>[-]]<
+[<<<<<<<<<<<<[-]++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++.+.-----------------------
+--------------------------------------------------------.+++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++.+++.----------
+---.---------------------------------------------------------------------.++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++
+++.+++++..--------.-------.++++++++++++++.[-]>>>>>>>>>>>>[-]]<<<<<<<<<<<<[-]
+++++++++++++++++++++++++++++++++.+++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++.---------.-----------------------------
+-----------------------------------------.++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++.+++..+++++++++++++.------------------------
+----------------------------------------------------------.+++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.-.-----------
+-------------------------------------------------------------------.++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+.------------.---.----------------------------------------------------------
+-----------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++.----------------------.+++++++++++..----------------
+----------------------------------------------.-----------------------------
+-------..[-]<<<<]>>>>[-]++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++.+++++++++++++++++++++++++++++++++.---------------
+----------------------------------------------------------------.+++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++.+++.--
+-----------.----------------------------------------------------------------
+-----.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++
+++++++++++.+++++..--------.-------.++++++++++++++.--------------------------
+---------------------------------------------------------.++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.---------.----
+------------------------------------------------------------------.+++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++..+++++++++++++
+.---------------------------------------------------------------------------
+-------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++.-.--------------------------------------------------------------
+----------------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++.------------.---.---------------------------------
+------------------------------------.+++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++.----------------------.++++
++++++++..----------------------------------------------------------------.--
+----------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++.+.------------------------------------------------------------
+-------------------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++.++.+++.-------------.---------------------------------
+------------------------------------.+++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++.+++++++++++++.+++++..--------.-------.++++++++++
+++++.-----------------------------------------------------------------------
+------------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++.---------.-------------------------------------------------
+---------------------.++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++.+++..+++++++++++++.--------------------------------------------
+------------------------.------------------------------------.++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++.++++++++++++++++++++++++++++
+++++++++++++.---------------------------------------------------------------
+----------------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++.-----.--------------------------------------------
+-----------------------------------.++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++.------------.---.--------------
+-------------------------------------------------------.++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+.-----.+++.
+-------------.--------------------------------------------------------------
+-------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++
++++++++++++.----------.-----------------------------------------------------
+---------------.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++.+++++++++++++++++++.++++.--------------------------------------------
+---------------------------------------------.++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++.----.--.--------.-----
+----------------------------------------------------------------.+++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.++.+++.--
+-----------.---------------------------------------------------------.------
+------.+++++++++++++++++++++++++..-------------------------.++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++++.+++++..----
+----.-------.++++++++++++++.------------------------------------------------
+-----------------------------------.++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++.---------.--------------------------
+--------------------------------------------.+++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++.+++..+++++++++++++.---------------------
+-------------------------------------------------------------.++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.-.--------
+----------------------------------------------------------------------.+++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++.------------.---.-------------------------------------------------------
+--------------.+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++.----------------------.+++++++++++..-------------
+-------------------------------------------------.--------------------------
+----------.[-]
@@ -0,0 +1,43 @@
+factor: every number from 2 to 255 followed by its prime factors
+
+a compute heavy workload: trial division by repeated subtraction with the
+divisor held in a cell so there are lots of copy loops in nested loops
+
+[-]++[>>>>>>>>>[-]>>[-]<<<<<<<<<<<[->>>>>>>>>+>>+<<<<<<<<<<<]>>>>>>>>>>>[-<<
+<<<<<<<<<+>>>>>>>>>>>]>>>>>[-]++++++++++<<[-]>[-]<<<<<<[->>>>>>>->>>[-]+<<[-
+]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++<<+>>>>>[-]]<<<<<<<<<
+<]>>>>>>++++++++++>[-<->][-]++++++++++>>>>[-]>[-]<<<<<<<[->>->>>[-]+<<[-]>[-
+]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++>>>>+<[-]]<<<<<]>>>>>>>++
+++++++++<<<<<[->>>>>-<<<<<]>>>>>>[-]<<<<<[-]>[-]>>[-<<<+>+>>]<<[->>+<<]<[>>>
+>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>>>>[->+<<<<<+>>>>]<<<<[->>>>+<<<<]<[-]>[-]>>>[
+-<<<<+>+>>>]<<<[->>>+<<<]<[>>>>>>[-]+<<<<<<[-]]>>>>>[<<+++++++++++++++++++++
++++++++++++++++++++++++++++.>>[-]]<<[-]>>>[<<+++++++++++++++++++++++++++++++
++++++++++++++++++.>>[-]]<<[-]<<<<<<+++++++++++++++++++++++++++++++++++++++++
++++++++.[-]<<[-]++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.[
+-]<<<<<<<<<<<<[-]>>>>>>>>>>[-]<<<<<<<<<<<[->+>>>>>>>>>>+<<<<<<<<<<<]>>>>>>>>
+>>>[-<<<<<<<<<<<+>>>>>>>>>>>]<<<<<<<<<[-]++>[-]>>>>>>>>[-]<<<<<<<<<<[->>+>>>
+>>>>>+<<<<<<<<<<]>>>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]<<<<<<<<->>>>>>>[-]>[-]<<
+<<<<<<[->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<<<[-]>>>>>>>[<<
+<<<<<+>>>>>>>[-]]<<<<<<<[>[-]>>>>>>>[-]<<<<<<<<<<[->>>+>>>>>>>+<<<<<<<<<<]>>
+>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]>[-]<[-]<<<<<<<<<[->>>>>>>>>>+<+<<<<<<<<<]>>
+>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<[-]>[-]<<[->>>>>>>>-<<<<<[-]+>>>>>>>>>>>>
+>>>>>>[-]<<<<<<<<<<<<<<[-]>[->>>>>>>>>>>>>+<<<<<<<<<<<<<<+>]<[->+<]>>>>>>>>>
+>>>>>[<<<<<<<<<<<<<<<<<<[-]>>>>>>>>>>>>>>>>>>[-]]<<<<<<<<<<<<<<<<<<[>>>>[-]<
+<<<<<<<<[->>>>>>>>>>+<+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<+>>[-]
+]<<<]>>>>>>>[-]<<<<<<<<<[->>>>+>>>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>
+>]>[-<<<<<<->>>>>>]<<<<<[-]+>[-]>>[-]>[-]<<<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>
+>>>]<[<<<[-]>+>>[-]]<<<[>>>>>>[-]++++++++++++++++++++++++++++++++.[-]<<<<[-]
+>>[-]<<<<<<<<<[->>>>>>>+>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]>>>>>[-]
+++++++++++<<[-]>[-]<<<<<<[->>>>>>>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>
+[-]<<[-]]>>[<<<++++++++++<<+>>>>>[-]]<<<<<<<<<<]>>>>>>++++++++++>[-<->][-]++
+++++++++>>>>[-]>[-]<<<<<<<[->>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<
+<[-]]>>[<<<++++++++++>>>>+<[-]]<<<<<]>>>>>>>++++++++++<<<<<[->>>>>-<<<<<]>>>
+>>>[-]<<<<<[-]>[-]>>[-<<<+>+>>]<<[->>+<<]<[>>>>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>
+>>>[->+<<<<<+>>>>]<<<<[->>>>+<<<<]<[-]>[-]>>>[-<<<<+>+>>>]<<<[->>>+<<<]<[>>>
+>>>[-]+<<<<<<[-]]>>>>>[<<++++++++++++++++++++++++++++++++++++++++++++++++.>>
+[-]]<<[-]>>>[<<++++++++++++++++++++++++++++++++++++++++++++++++.>>[-]]<<[-]<
+<<<<<++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<<<<<<<<<<<<[-]>>
+>>[-<<<<+>>>>]>>[-]]>[<<<<<<+>>>>>>[-]]<<<[-]>[-]<<<[-]>>>>>>>>[-]<<<<<<<<<<
+[->>+>>>>>>>>+<<<<<<<<<<]>>>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]<<<<<<<<->>>>>>>[
+-]>[-]<<<<<<<<[->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<<<[-]>>
+>>>>>[<<<<<<<+>>>>>>>[-]]<<<<<<<]>>>>>>>>>>[-]++++++++++.[-]<<<<<<<<<<<<<+]
@@ -0,0 +1,93 @@
+hanoi: the moves that solve the towers of hanoi for 20 disks
+
+every disk gets a block of cells holding its peg and which way it moves
+and the disk to move next is found by counting up in binary across those
+blocks so the cell pointer moves by amounts only known at run time
+
+>>>+>+>>>>>>>>>>>>>>>>>>>>>>+>>>++>>>>>>>>>>>>>>>>>>>>>>+>>+>+++>>>>>>>>>>>>
+>>>>>>>>>>+>>>++++>>>>>>>>>>>>>>>>>>>>>>+>>+>+++++>>>>>>>>>>>>>>>>>>>>>>+>>>
+++++++>>>>>>>>>>>>>>>>>>>>>>+>>+>+++++++>>>>>>>>>>>>>>>>>>>>>>+>>>++++++++>>
+>>>>>>>>>>>>>>>>>>>>+>>+>+++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>++++++++++>>>>>>
+>>>>>>>>>>>>>>>>+>>+>+++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>++++++++++++>>>>>>
+>>>>>>>>>>>>>>>>+>>+>+++++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>++++++++++++++>>
+>>>>>>>>>>>>>>>>>>>>+>>+>+++++++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>++++++++++
+++++++>>>>>>>>>>>>>>>>>>>>>>+>>+>+++++++++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>
+++++++++++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>+>+++++++++++++++++++>>>>>>>>>>>>
+>>>>>>>>>>+>>>++++++++++++++++++++>>>>>>>>>>>>>>>>>>>>>>+>>>>+<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<+[<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>]+>>>>>>[-]+
+>[-]>>[-]<<<<[->>+>>+<<<<]>>>>[-<<<<+>>>>]<<[<[-]>[-]]<[>>>>[-]+++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.+++++++++++
++++++++++++++++++++++++.+++++++.-----------------.--------------------------
+-------------------------------------------.++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++.+++++.++++++++++.--------.-------------
+--------------------------------------------------------------.[-]>[-]<<[-]<
+<<<<[->>>>>>>+<<+<<<<<]>>>>>[-<<<<<+>>>>>]>>>>>>[-]++++++++++<<[-]>[-]<<<[->
+>>>->>>[-]+<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++<<+>>>
+>>[-]]<<<<<<<]>>>++++++++++>[-<->][-]++++++++++>>>>[-]>[-]<<<<<<<[->>->>>[-]
++<<[-]>[-]<<[->+>+<<]>>[-<<+>>]<[>>[-]<<[-]]>>[<<<++++++++++>>>>+<[-]]<<<<<]
+>>>>>>>++++++++++<<<<<[->>>>>-<<<<<]>>>>>>[-]<<<<<[-]>[-]>>[-<<<+>+>>]<<[->>
++<<]<[>>>>>+<<<<<[-]]>>>>>>[-]<<<<<[-]>>>>[->+<<<<<+>>>>]<<<<[->>>>+<<<<]<[-
+]>[-]>>>[-<<<<+>+>>>]<<<[->>>+<<<]<[>>>>>>[-]+<<<<<<[-]]>>>>>[<<++++++++++++
+++++++++++++++++++++++++++++++++++++.>>[-]]<<[-]>>>[<<++++++++++++++++++++++
+++++++++++++++++++++++++++.>>[-]]<<[-]<<<<<<++++++++++++++++++++++++++++++++
+++++++++++++++++.[-]<<<<[-]++++++++++++++++++++++++++++++++.++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++.++++++++++++.---.--.-
+----------------------------------------------------------------------------
+.[-]>[-]<<[-]<<<<<<<[->>>>>>>>>+<<+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]>>++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.[-]>[-]<<<[-]<<<
+<<<<[->>>>>>>>>>+<<<+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]>>>++<<<<[-]>[-]<<<<<<
+[->>>>>+>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<[->>>>-<<<<]<[-]+>[-]>[-]>>>[-<<<<+>
++>>>]<<<[->>>+<<<]<---[<[-]>[-]]<[>>>>>[-]<<<<<[-]][-]+>[-]>[-]>>>[-<<<<+>+>
+>>]<<<[->>>+<<<]<----[<[-]>[-]]<[>>>>>[-]+<<<<<[-]]>>>[-]+++++++++++++++++++
++++++++++++++.++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++.-----.-----------------------------------------------
+--------------------------------.[-]>[-]<<[-]>>>[-<+<<+>>>]<<<[->>>+<<<]>>++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.[-]<[-]+++++
++++++.[-]<<<<<<<<[-]>>>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]<<<<<<[-]]<<<<<[<<<<<<
+<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>[-]+<<<<<<<<<<<<<<<<[-]>[-]>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>+>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]<[>>>>>>>>>>>
+>>>>>[-]<<<<<<<<<<<<<<<<[-]]>>>>>>>>>>>>>>>>]
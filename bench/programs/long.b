@@ -0,0 +1,30 @@
+long: the classic long running loop nest
+
+five levels of nested loops that do little but count and clear
+prints a single byte
+
+>+>+>+>+>++<[>[<+++>-
+
+ >>>>>
+ >+>+>+>+>++<[>[<+++>-
+
+   >>>>>
+   >+>+>+>+>++<[>[<+++>-
+
+     >>>>>
+     >+>+>+>+>++<[>[<+++>-
+
+       >>>>>
+       +++[->+++++<]>[-]<
+
+       <<<<<
+     ]<<]>[-]
+
+     <<<<<
+   ]<<]>[-]
+
+   <<<<<
+ ]<<]>[-]
+
+ <<<<<
+]<<]>.
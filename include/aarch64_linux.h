@@ -0,0 +1,12 @@
+#ifndef __BUDGIE_AARCH64_LINUX_INC_H
+#define __BUDGIE_AARCH64_LINUX_INC_H
+#include <rudolph/buffer.h>
+#include "options.h"
+
+#define BUDGIE_AARCH64_RELOCS 5 /* tape, output buffer, input buffer, and the
+                                 * starting cells and output in data */
+
+/* compile a program to an aarch64 linux executable */
+int budgie_translate_aarch64_linux(rd_buf_t *in, const struct budgie_options *opts, rd_buf_t **out);
+
+#endif /* __BUDGIE_AARCH64_LINUX_INC_H */
@@ -0,0 +1,22 @@
+#ifndef __BUDGIE_BACKEND_INC_H
+#define __BUDGIE_BACKEND_INC_H
+#include <rudolph/buffer.h>
+#include "options.h"
+
+/* a machine budgie can generate code for */
+struct budgie_backend {
+    const char *name; /* what --target calls it */
+    /* compile a program to an executable */
+    int (*translate)(rd_buf_t *in, const struct budgie_options *opts, rd_buf_t **out);
+    /* compile a program and run it right away, or NULL if budgie isn't
+     * running on this machine */
+    int (*run)(rd_buf_t *in, const struct budgie_options *opts);
+    int profile; /* 1 if it can instrument programs and use their profiles */
+};
+
+/* the backend called <name>, or NULL if there isn't one */
+const struct budgie_backend *budgie_backend_find(const char *name);
+/* the backend for the machine budgie was built for */
+const struct budgie_backend *budgie_backend_default(void);
+
+#endif /* __BUDGIE_BACKEND_INC_H */
@@ -0,0 +1,24 @@
+#ifndef __BUDGIE_BATCH_INC_H
+#define __BUDGIE_BATCH_INC_H
+#include <stddef.h>
+#include "compile.h"
+
+/* what to do with every program in a batch */
+struct budgie_batch_options {
+    const struct budgie_compile_options *compile; /* opts->stats has to be
+                                                   * NULL, since the threads
+                                                   * can't share it */
+    int jobs; /* number of threads to compile on */
+};
+
+/* compile the <n> programs in the files <names>, each to an executable named
+ * after its source (see budgie_batch_output_name), spread over bopts->jobs
+ * threads. a program that fails doesn't stop the others. returns nonzero if
+ * any of them failed */
+int budgie_batch_compile(char **names, size_t n, const struct budgie_batch_options *bopts);
+/* the name of the executable for the source <name>: the same name without a
+ * `.b' or `.bf' extension, or with `.out' added if it has neither. the result
+ * has to be freed */
+char *budgie_batch_output_name(const char *name);
+
+#endif /* __BUDGIE_BATCH_INC_H */
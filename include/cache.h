@@ -0,0 +1,44 @@
+#ifndef __BUDGIE_CACHE_INC_H
+#define __BUDGIE_CACHE_INC_H
+#include <stddef.h>
+#include <rudolph/buffer.h>
+#include "options.h"
+
+#define BUDGIE_CACHE_SIZE ((size_t)256 << 20) /* most bytes kept by default */
+#define BUDGIE_CACHE_KEY_LEN 64 /* hex digits in a key */
+#define BUDGIE_CACHE_STALE 3600 /* seconds after which a half-written entry
+                                 * is taken to be left over from a crash */
+
+/* a directory of executables, each named after the key it was compiled for.
+ * entries are only ever added whole (by renaming them into place) and
+ * removed whole, so any number of budgies can share one */
+struct budgie_cache {
+    char *dir;
+    size_t max_size; /* the oldest entries go once they add up to more */
+};
+
+/* the directory to use when none is given: $XDG_CACHE_HOME/budgie, or
+ * ~/.cache/budgie. NULL if there's no telling where that is, otherwise it
+ * has to be freed */
+char *budgie_cache_default_dir(void);
+/* use the cache in <dir>, creating it if it isn't there */
+int budgie_cache_open(struct budgie_cache *cache, const char *dir, size_t max_size);
+/* free what budgie_cache_open allocated */
+void budgie_cache_close(struct budgie_cache *cache);
+/* work out the key for compiling the source in <fd> for <target> with
+ * <opts>, <optimize>, <peval_steps> and the profile in the file <profile>
+ * (or NULL), and the budgie doing the compiling. <fd> has to be a regular
+ * file, and is left at its start */
+int budgie_cache_key(int fd, const struct budgie_options *opts, const char *target, int optimize,
+                     size_t peval_steps, const char *profile, char key[BUDGIE_CACHE_KEY_LEN + 1]);
+/* put the executable for <key> in the file <out_name>, or on stdout if that's
+ * NULL. returns 0 if it was there, 1 if it wasn't */
+int budgie_cache_get(const struct budgie_cache *cache, const char *key, const char *out_name);
+/* keep <exe> for <key>. the cache can grow past its size until the next
+ * budgie_cache_evict */
+int budgie_cache_put(const struct budgie_cache *cache, const char *key, rd_buf_t *exe);
+/* drop the entries used least recently until the rest fit. this looks at
+ * every entry, so it's done once after all the compiling, not per put */
+int budgie_cache_evict(const struct budgie_cache *cache);
+
+#endif /* __BUDGIE_CACHE_INC_H */
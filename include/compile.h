@@ -0,0 +1,48 @@
+#ifndef __BUDGIE_COMPILE_INC_H
+#define __BUDGIE_COMPILE_INC_H
+#include <stddef.h>
+#include <rudolph/buffer.h>
+#include "backend.h"
+#include "cache.h"
+#include "ir.h"
+#include "options.h"
+#include "peval.h"
+#include "profile.h"
+
+/* how to compile a program, the same for the one main.c compiles and for
+ * every program in a batch */
+struct budgie_compile_options {
+    const struct budgie_options *opts; /* start and profile have to be NULL */
+    const struct budgie_backend *backend; /* what to compile for */
+    int optimize; /* 1 to run the optimizer */
+    size_t peval_steps; /* ops to run at compile time, or 0 */
+    const char *profile; /* the file an instrumented run wrote, or NULL */
+    const struct budgie_cache *cache; /* where to keep executables, or NULL */
+};
+
+/* a program on its way to being translated */
+struct budgie_program {
+    struct budgie_options opts; /* the options, with start and profile
+                                 * pointing at the ones below if there are
+                                 * any */
+    rd_buf_t *ir;
+    struct budgie_loops loops;
+    struct budgie_peval peval;
+    struct budgie_profile profile;
+};
+
+/* parse the program in <fd>, optimize it, run what can be run at compile
+ * time and read its profile, as <copts> say. errors are printed, after
+ * <name> if that isn't NULL. <prog> has to be freed with budgie_program_free
+ * even if this fails */
+int budgie_compile_ir(int fd, const struct budgie_compile_options *copts, const char *name,
+                      struct budgie_program *prog);
+/* free what budgie_compile_ir filled in */
+void budgie_program_free(struct budgie_program *prog);
+/* compile the program in <fd> to the executable <out_name>, or to stdout if
+ * that's NULL, handing out the one in the cache instead if there is one and
+ * putting it there if not. errors are printed like budgie_compile_ir does */
+int budgie_compile(int fd, const char *out_name, const struct budgie_compile_options *copts,
+                   const char *name);
+
+#endif /* __BUDGIE_COMPILE_INC_H */
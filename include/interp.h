@@ -0,0 +1,11 @@
+#ifndef __BUDGIE_INTERP_INC_H
+#define __BUDGIE_INTERP_INC_H
+#include <rudolph/buffer.h>
+#include "options.h"
+
+/* run an oplist in the interpreter, with stdin and stdout as its input and
+ * output. returns nonzero if the program can't be run, or if it moves the
+ * cell pointer off the tape */
+int budgie_interp_run(rd_buf_t *in, const struct budgie_options *opts);
+
+#endif /* __BUDGIE_INTERP_INC_H */
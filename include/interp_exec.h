@@ -0,0 +1,105 @@
+/* the interpreter's main loop, included by interp.c once for each cell size
+ * with BUDGIE_CELL set to the type of a cell and BUDGIE_INTERP_EXEC to the
+ * name of the function to define. it runs <code> on the tape of <ncells>
+ * cells at <cells>, starting at the cell <start>, and returns nonzero if the
+ * program moves the cell pointer off the tape */
+static int BUDGIE_INTERP_EXEC(struct budgie_insn *code, struct budgie_interp_io *io,
+                              BUDGIE_CELL *cells, size_t ncells, size_t start) {
+#ifdef __GNUC__
+    __extension__ static const void *const labels[BIT_END + 1] = {
+        &&h_BIT_MOVE, &&h_BIT_ADD, &&h_BIT_SET, &&h_BIT_MULA, &&h_BIT_OUT,
+        &&h_BIT_IN, &&h_BIT_LOPEN, &&h_BIT_LCLOS, &&h_BIT_SCAN, &&h_BIT_END
+    };
+    size_t i;
+#endif
+    struct budgie_insn *ip;
+    BUDGIE_CELL *p;
+    unsigned char c;
+    int n;
+
+#ifdef __GNUC__
+    for (i = 0; code[i].type != BIT_END; i++) code[i].label = labels[code[i].type];
+    code[i].label = labels[BIT_END];
+#endif
+
+    p = cells + start;
+    ip = code;
+
+#ifdef __GNUC__
+    BUDGIE_DISPATCH;
+    {
+#else
+dispatch:
+    switch (ip->type) {
+#endif
+    BUDGIE_HANDLER(BIT_MOVE):
+        if ((size_t)((p - cells) + ip->arg) >= ncells) goto off_tape;
+        p += ip->arg;
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_ADD):
+        p[ip->off] += (BUDGIE_CELL)ip->arg;
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_SET):
+        p[ip->off] = (BUDGIE_CELL)ip->arg;
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_MULA):
+        p[ip->off] += (BUDGIE_CELL)(p[ip->src] * (uint32_t)ip->arg);
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_OUT):
+        c = (unsigned char)p[ip->off];
+        io->out[io->out_len++] = c;
+        if (io->out_len >= io->out_max || (c == '\n' && io->line)) budgie_interp_flush(io);
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_IN):
+        if (io->in_pos < io->in_len) {
+            p[ip->off] = io->in[io->in_pos++];
+        } else {
+            n = budgie_interp_getc(io);
+            if (n >= 0) p[ip->off] = n;
+            else if (io->eof == BEOF_ZERO) p[ip->off] = 0;
+            else if (io->eof == BEOF_MINUS_ONE) p[ip->off] = (BUDGIE_CELL)-1;
+        }
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_LOPEN):
+        ip = *p ? ip + 1 : code + ip->arg;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_LCLOS):
+        ip = *p ? code + ip->arg : ip + 1;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_SCAN):
+        if (ip->arg == 1 && sizeof(BUDGIE_CELL) == 1) {
+            p = memchr(p, 0, cells + ncells - p);
+            if (!p) goto off_tape;
+        } else {
+            while (*p) {
+                if ((size_t)((p - cells) + ip->arg) >= ncells) goto off_tape;
+                p += ip->arg;
+            }
+        }
+        ip++;
+        BUDGIE_DISPATCH;
+
+    BUDGIE_HANDLER(BIT_END):
+        /* write out whatever is still buffered */
+        budgie_interp_flush(io);
+    }
+    return 0;
+
+off_tape:
+    budgie_interp_flush(io);
+    return -__LINE__;
+}
@@ -1,8 +1,12 @@
 #ifndef __BUDGIE_OPLIST_INC_H
 #define __BUDGIE_OPLIST_INC_H
+#include <stddef.h>
+#include <stdint.h>
 #include <rudolph/buffer.h>
 
-#define BUDGIE_MAX_ARG 255
+#define BUDGIE_MAX_ARG 0x7FFFFFFF
+#define BUDGIE_MAX_OP_SZ 16 /* header byte + 3 operands of up to 5 bytes */
+#define BUDGIE_FOLD_WINDOW 64 /* most ops to look back over for one to fold into */
 
 enum budgie_op_type {
     /* basic brainfuck arguments */
@@ -12,21 +16,106 @@ enum budgie_op_type {
     BOPT_D_DECR, /* arg is how many to subtract by */
     BOPT_D_OUT, /* arg unused */
     BOPT_D_IN, /* arg unused */
-    BOPT_F_LOPEN, /* arg unused */
-    BOPT_F_LCLOS, /* arg unused */
+    BOPT_F_LOPEN, /* arg is the index of the loop in the loop table */
+    BOPT_F_LCLOS, /* arg is the index of the loop in the loop table */
     /* advanced optimization stuff */
     BOPT_NOOP, /* arg unused */
     BOPT_D_SET, /* arg is value to set to */
-    _BOPT_MAX = BUDGIE_MAX_ARG /* maximum type */
-} __attribute__ ((__packed__));
+    BOPT_D_MULA, /* add the cell src away times arg to the cell off away */
+    BOPT_P_SCAN, /* move by arg (negative to go back) until the cell is 0 */
+    _BOPT_MAX = 0x1F /* maximum type */
+};
+
+/* ops are stored in the oplist buffer in a variable-width encoding, to keep
+ * it small no matter how large the operands get: a header byte holding the
+ * type in the low 5 bits and one bit per operand that is present, followed by
+ * the present operands as zigzag-encoded LEB128 varints. a missing arg is 1,
+ * a missing off or src is 0, which covers most ops in a single byte. */
+#define BOPH_TYPE   0x1F
+#define BOPH_ARG    0x20
+#define BOPH_OFF    0x40
+#define BOPH_SRC    0x80
 
-struct __attribute__((__packed__)) budgie_op {
+/* decoded form of an op */
+struct budgie_op {
     enum budgie_op_type type;
-    unsigned char arg;
+    int32_t arg;
+    int32_t off; /* offset of the cell the op works on, for BOPT_D_* */
+    int32_t src; /* offset of the cell to multiply, for BOPT_D_MULA */
+};
+
+#define BUDGIE_NO_LOOP ((size_t)-1)
+
+/* where a loop is in an oplist */
+struct budgie_loop {
+    size_t open; /* offset of its BOPT_F_LOPEN */
+    size_t close; /* offset of its BOPT_F_LCLOS */
+    size_t parent; /* index of the loop it is in, or BUDGIE_NO_LOOP */
+};
+
+/* the loops of an oplist, in the order they open. the arg of both of a loop's
+ * brackets is its index in here, so either end can find the other one (or the
+ * loop around it) straight away. the table is built as the oplist is written,
+ * by the parser and then by each pass as it writes its new oplist */
+struct budgie_loops {
+    struct budgie_loop *loop;
+    size_t n; /* number of loops */
+    size_t sz; /* number of loops there is room for */
+    size_t cur; /* innermost loop that is still open, or BUDGIE_NO_LOOP */
 };
 
-int budgie_oplist_create(rd_buf_t *in, rd_buf_t **out);
-int budgie_oplist_optimize(rd_buf_t **in);
+/* start an empty loop table */
+void budgie_loops_init(struct budgie_loops *loops);
+/* free a loop table */
+void budgie_loops_free(struct budgie_loops *loops);
+/* add a loop opening at <pos> inside the current one, and make it the current
+ * one. returns its index, or -1 if it can't be added */
+long budgie_loops_open(struct budgie_loops *loops, size_t pos);
+/* close the current loop at <pos>. returns its index, or -1 if there is no
+ * loop open */
+long budgie_loops_close(struct budgie_loops *loops, size_t pos);
+/* take back the last loop opened, which has to be the current one */
+void budgie_loops_drop(struct budgie_loops *loops);
+
+struct budgie_stats;
+
+/* state of a parse that gets its input a piece at a time */
+struct budgie_parser {
+    rd_buf_t *out; /* the oplist so far */
+    size_t nbytes; /* number of bytes parsed so far */
+    struct budgie_op last_op; /* op being grouped, BOPT_NOOP if none */
+    struct budgie_loops loops; /* the loops so far */
+};
+
+/* start a new parse of a program about <hint> bytes long (0 if that isn't
+ * known), which the oplist is sized for up front */
+void budgie_parser_init(struct budgie_parser *p, size_t hint);
+/* parse the next <len> bytes of the program */
+int budgie_parser_feed(struct budgie_parser *p, const unsigned char *data, size_t len);
+/* finish the parse and hand over the oplist and its loops (even if it
+ * failed). */
+int budgie_parser_finish(struct budgie_parser *p, rd_buf_t **out, struct budgie_loops *loops);
+
+/* parse a whole program at once */
+int budgie_oplist_create(rd_buf_t *in, rd_buf_t **out, struct budgie_loops *loops);
+/* parse the program in <fd>, mapping it into memory a window at a time if it
+ * is a regular file and reading it a chunk at a time otherwise, so that the
+ * source never has to be held in memory in full. <nbytes> is set to the size
+ * of the source */
+int budgie_parse_fd(int fd, rd_buf_t **out, struct budgie_loops *loops, size_t *nbytes);
+/* optimize the oplist, replacing <loops> with the loops of the new one, and
+ * counting what was done in <stats> if it isn't NULL */
+int budgie_oplist_optimize(rd_buf_t **in, struct budgie_loops *loops, struct budgie_stats *stats);
+
+/* encode an op to <out>, which has room for BUDGIE_MAX_OP_SZ bytes.
+ * returns the number of bytes written */
+size_t budgie_op_encode(const struct budgie_op *op, unsigned char *out);
+/* decode the op at <in>. returns the number of bytes read */
+size_t budgie_op_decode(const unsigned char *in, struct budgie_op *op);
+/* append an op to the end of an oplist */
+int budgie_op_push(rd_buf_t **out, const struct budgie_op *op);
+/* short name of an op type, or NULL if there is no such type */
+const char *budgie_op_name(enum budgie_op_type type);
 
 #endif /* __BUDGIE_OPLIST_INC_H */
 
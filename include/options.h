@@ -0,0 +1,65 @@
+#ifndef __BUDGIE_OPTIONS_INC_H
+#define __BUDGIE_OPTIONS_INC_H
+
+#define BUDGIE_TAPE_CELLS 131072 /* number of cells on the tape by default */
+#define BUDGIE_MMAP_CELLS 1073741824 /* and with BTAPE_MMAP, where only the
+                                      * pages that get used take up memory */
+#define BUDGIE_MAX_TAPE_CELLS ((size_t)1 << 40) /* most cells --tape-size takes */
+#define BUDGIE_ALIGN_BYTES 32 /* what loops are aligned to by default */
+
+/* where the tape lives */
+enum budgie_tape {
+    BTAPE_STATIC, /* in bss, with the pointer starting at the first cell */
+    BTAPE_MMAP /* mapped at startup between guard pages, with the pointer
+                * starting in the middle */
+};
+
+/* how the generated program buffers its input and output */
+enum budgie_io_buffer {
+    BIOB_NONE, /* one syscall per `.` or `,` */
+    BIOB_LINE, /* flush on newline, when full, before reading and at exit */
+    BIOB_FULL /* flush when full, before reading and at exit */
+};
+
+/* what `,` stores in the cell once the input has run out */
+enum budgie_eof {
+    BEOF_UNCHANGED, /* leave the cell as it was */
+    BEOF_ZERO, /* set the cell to 0 */
+    BEOF_MINUS_ONE /* set the cell to -1 */
+};
+
+/* which loops get their bodies aligned, so each time around takes as few
+ * fetches as it can */
+enum budgie_align {
+    BALIGN_NONE, /* none of them */
+    BALIGN_HOT, /* the ones the profile says are hot */
+    BALIGN_INNER, /* innermost loops, and hot ones */
+    BALIGN_ALL /* every loop */
+};
+
+struct budgie_stats;
+struct budgie_peval;
+struct budgie_profile;
+
+/* options that change the code a backend generates */
+struct budgie_options {
+    enum budgie_io_buffer io_buffer;
+    enum budgie_eof eof;
+    enum budgie_tape tape;
+    size_t tape_size; /* number of cells on the tape */
+    int cell_size; /* bytes per cell: 1, 2 or 4 */
+    struct budgie_stats *stats; /* where to count things, or NULL */
+    const struct budgie_peval *start; /* where the program starts from, or
+                                       * NULL for a blank tape */
+    const char *instrument; /* file the program writes how many times each
+                             * loop ran to when it exits, or NULL */
+    const struct budgie_profile *profile; /* loop counts from an instrumented
+                                           * run of the program, or NULL */
+    enum budgie_align align; /* which loops to align */
+    int align_bytes; /* and what to (a power of two) */
+};
+
+/* the cell the pointer starts at, counting from the start of the tape */
+#define BUDGIE_TAPE_START(opts) ((opts)->tape == BTAPE_MMAP ? (opts)->tape_size / 2 : 0)
+
+#endif /* __BUDGIE_OPTIONS_INC_H */
@@ -0,0 +1,31 @@
+#ifndef __BUDGIE_PEVAL_INC_H
+#define __BUDGIE_PEVAL_INC_H
+#include <stddef.h>
+#include <rudolph/buffer.h>
+#include "ir.h"
+
+#define BUDGIE_PEVAL_STEPS 1000000 /* ops to run at compile time by default */
+#define BUDGIE_PEVAL_MAX_OUTPUT 1048576 /* most output to print at startup */
+#define BUDGIE_PEVAL_CELLS 131072 /* most cells to work out */
+
+/* where a program is after running the start of it at compile time */
+struct budgie_peval {
+    rd_buf_t *tape; /* the cells from the first up to the last one that isn't 0, as bytes */
+    rd_buf_t *output; /* what it printed along the way */
+    size_t pos; /* where the cell pointer ended up */
+};
+
+struct budgie_stats;
+
+/* run as much of the program as can be run without any input, starting from
+ * a blank tape, for up to <steps> ops and the first <cells> cells of
+ * <cell_size> bytes from where the pointer starts (at most BUDGIE_PEVAL_CELLS). the program (and <loops>) are replaced
+ * by the rest of it, which has to start from the state put in <out> instead.
+ * a loop is only ever run all the way or not at all, so the rest of the
+ * program always starts between two ops outside of any loop */
+int budgie_peval(rd_buf_t **in, struct budgie_loops *loops, size_t steps, size_t cells,
+                 int cell_size, struct budgie_peval *out, struct budgie_stats *stats);
+/* free what budgie_peval filled in */
+void budgie_peval_free(struct budgie_peval *peval);
+
+#endif /* __BUDGIE_PEVAL_INC_H */
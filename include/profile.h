@@ -0,0 +1,34 @@
+#ifndef __BUDGIE_PROFILE_INC_H
+#define __BUDGIE_PROFILE_INC_H
+#include <stddef.h>
+#include <stdint.h>
+#include <rudolph/buffer.h>
+
+#define BUDGIE_PROFILE_NAME "budgie.prof" /* file --instrument and --profile-use use by default */
+#define BUDGIE_PROFILE_MAGIC "budgprof" /* what a profile starts with */
+#define BUDGIE_PROFILE_HEADER 24 /* the magic, then the program's hash and
+                                  * number of loops as 64 bit little-endian
+                                  * numbers, then a count for each loop */
+#define BUDGIE_PROFILE_HOT 100 /* a loop is hot if it runs at least 1/<this>
+                                * of all the iterations of every loop */
+
+/* how many times each loop of a program went around in an instrumented run */
+struct budgie_profile {
+    uint64_t hash; /* budgie_profile_hash of the program that was run */
+    size_t nloops; /* number of loops counted */
+    uint64_t *counts; /* iterations of each loop, by loop number */
+    uint64_t total; /* and of all of them together */
+};
+
+/* a hash of an oplist, to tell whether a profile is for the same program */
+uint64_t budgie_profile_hash(rd_buf_t *ir);
+/* the header an instrumented program writes before its counts */
+void budgie_profile_header(uint64_t hash, size_t nloops, unsigned char out[BUDGIE_PROFILE_HEADER]);
+/* read the profile written by an instrumented program */
+int budgie_profile_read(const char *name, struct budgie_profile *out);
+/* whether the loop <loop> spent enough time running to be worth more code */
+int budgie_profile_hot(const struct budgie_profile *profile, size_t loop);
+/* free what budgie_profile_read filled in */
+void budgie_profile_free(struct budgie_profile *profile);
+
+#endif /* __BUDGIE_PROFILE_INC_H */
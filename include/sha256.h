@@ -0,0 +1,23 @@
+#ifndef __BUDGIE_SHA256_INC_H
+#define __BUDGIE_SHA256_INC_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUDGIE_SHA256_LEN 32 /* bytes in a hash */
+
+/* a SHA-256 hash partway through */
+struct budgie_sha256 {
+    uint32_t h[8]; /* the state */
+    unsigned char block[64]; /* bytes waiting for a whole block */
+    size_t len; /* how many */
+    uint64_t bits; /* bits hashed so far */
+};
+
+/* start a hash */
+void budgie_sha256_init(struct budgie_sha256 *ctx);
+/* add <len> bytes to it */
+void budgie_sha256_update(struct budgie_sha256 *ctx, const void *data, size_t len);
+/* finish it, putting the hash in <out> */
+void budgie_sha256_final(struct budgie_sha256 *ctx, unsigned char out[BUDGIE_SHA256_LEN]);
+
+#endif /* __BUDGIE_SHA256_INC_H */
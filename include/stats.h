@@ -0,0 +1,59 @@
+#ifndef __BUDGIE_STATS_INC_H
+#define __BUDGIE_STATS_INC_H
+#include <stdio.h>
+#include <stddef.h>
+#include "ir.h"
+
+#define BUDGIE_NGRAM_MAX 4 /* longest runs of ops budgie_stats_ngrams counts */
+
+/* phases of a compile that get timed */
+enum budgie_stats_phase {
+    BSP_PARSE, /* reading the source and building the IR */
+    BSP_OPTIMIZE, /* running the optimizer passes */
+    BSP_TRANSLATE, /* generating code and linking it */
+    BSP_WRITE, /* writing the executable out */
+    BSP_RUN, /* running the program, with --run */
+    _BSP_MAX
+};
+
+/* what happened during a compile, for --stats */
+struct budgie_stats {
+    double wall[_BSP_MAX]; /* seconds spent in each phase */
+    double cpu[_BSP_MAX]; /* cpu seconds spent in each phase */
+    size_t input_bytes; /* size of the source */
+    size_t ops_before[_BOPT_MAX + 1]; /* ops of each type before optimizing */
+    size_t ops_after[_BOPT_MAX + 1]; /* and after */
+    size_t ir_bytes_before; /* size of the encoded IR before optimizing */
+    size_t ir_bytes_after; /* and after */
+    size_t loops_scan; /* loops turned into BOPT_P_SCAN */
+    size_t loops_mula; /* loops turned into BOPT_D_MULA's */
+    size_t loops_clear; /* [-] and [+] loops turned into a BOPT_D_SET */
+    size_t loops_dead; /* loops dropped since they could never run */
+    size_t loops_hot; /* loops the profile said were hot */
+    size_t loops_aligned; /* loops whose bodies got aligned */
+    size_t ops_folded; /* ops folded into another one, or dropped */
+    size_t peval_steps; /* ops run at compile time */
+    size_t peval_cells; /* cells the program starts with already set */
+    size_t peval_output; /* bytes of output worked out at compile time */
+    size_t code_bytes; /* size of the generated machine code */
+    size_t output_bytes; /* size of the executable */
+    double mark_wall, mark_cpu; /* when the current phase started */
+};
+
+/* clear the stats and start timing the first phase */
+void budgie_stats_init(struct budgie_stats *stats);
+/* add the time since the last phase ended to <phase> */
+void budgie_stats_phase(struct budgie_stats *stats, enum budgie_stats_phase phase);
+/* start timing the next phase from now, so counting things in between
+ * doesn't get added to it */
+void budgie_stats_mark(struct budgie_stats *stats);
+/* count the ops of each type in an oplist */
+void budgie_stats_count(rd_buf_t *ops, size_t counts[_BOPT_MAX + 1]);
+/* print the stats as text, or as a single line of json */
+void budgie_stats_print(const struct budgie_stats *stats, int json, FILE *fp);
+/* count every run of <n> ops in a row (up to BUDGIE_NGRAM_MAX) in an oplist by
+ * their types, and print a line for each one that came up: the count, then
+ * the names of the op types, most common first */
+int budgie_stats_ngrams(rd_buf_t *ops, int n, FILE *fp);
+
+#endif /* __BUDGIE_STATS_INC_H */
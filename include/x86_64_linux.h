@@ -0,0 +1,25 @@
+#ifndef __BUDGIE_X86_64_LINUX_INC_H
+#define __BUDGIE_X86_64_LINUX_INC_H
+#include <stddef.h>
+#include <rudolph/buffer.h>
+#include <rudolph/elf_link.h>
+#include "options.h"
+
+#define BUDGIE_X86_64_RELOCS 8 /* tape, output buffer, input buffer, loop
+                                * counters, and the starting cells, output
+                                * and profile header in data */
+
+/* generate the code for a program, along with its data, the relocations it
+ * needs (at most BUDGIE_X86_64_RELOCS of them, then a RELOC_NULL) and the size
+ * of the bss it expects. with <jit> set, the code is a function to be called
+ * in budgie's own process instead of a whole program, and returns instead of
+ * exiting */
+int budgie_translate_x86_64_code(rd_buf_t *in, const struct budgie_options *opts, int jit,
+                                 rd_buf_t **out, rd_buf_t **out_data,
+                                 struct rd_elf_link_relocation *relocs, size_t *out_bss_size);
+/* compile a program to an executable */
+int budgie_translate_x86_64_linux(rd_buf_t *in, const struct budgie_options *opts, rd_buf_t **out);
+/* compile a program and run it right away */
+int budgie_run_x86_64_linux(rd_buf_t *in, const struct budgie_options *opts);
+
+#endif /* __BUDGIE_X86_64_LINUX_INC_H */
@@ -0,0 +1,36 @@
+/* this file lists the backends, so the rest of budgie can pick one by name
+ * instead of calling into a particular one */
+#include <stddef.h>
+#include <string.h>
+#include <rudolph/buffer.h>
+#include "aarch64_linux.h"
+#include "backend.h"
+#include "options.h"
+#include "x86_64_linux.h"
+
+static const struct budgie_backend budgie_backends[] = {
+#if defined(__x86_64__)
+    { "x86_64", budgie_translate_x86_64_linux, budgie_run_x86_64_linux, 1 },
+#else
+    { "x86_64", budgie_translate_x86_64_linux, NULL, 1 },
+#endif
+    { "aarch64", budgie_translate_aarch64_linux, NULL, 0 },
+    { NULL, NULL, NULL, 0 }
+};
+
+const struct budgie_backend *budgie_backend_find(const char *name) {
+    const struct budgie_backend *backend;
+
+    for (backend = budgie_backends; backend->name; backend++) {
+        if (!strcmp(backend->name, name)) return backend;
+    }
+    return NULL;
+}
+
+const struct budgie_backend *budgie_backend_default(void) {
+#if defined(__aarch64__)
+    return budgie_backend_find("aarch64");
+#else
+    return budgie_backend_find("x86_64");
+#endif
+}
@@ -0,0 +1,122 @@
+/* this file compiles many programs in one go, on a pool of threads. every
+ * program is a job of its own that goes through budgie_compile just like a
+ * single compile in main.c does, with nothing shared between jobs but the
+ * list of programs left to compile (and the cache, which can take it) */
+#define _POSIX_C_SOURCE 199506L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "cache.h"
+#include "compile.h"
+
+/* the programs, and how far through them the threads are */
+struct budgie_batch {
+    char **names;
+    size_t n;
+    size_t next; /* the next program to hand out */
+    int failed; /* 1 once any program failed */
+    pthread_mutex_t lock; /* held while touching next or failed */
+    const struct budgie_batch_options *bopts;
+};
+
+char *budgie_batch_output_name(const char *name) {
+    size_t len;
+    char *out;
+
+    len = strlen(name);
+    out = malloc(len + 5);
+    if (!out) return NULL;
+    memcpy(out, name, len + 1);
+
+    if (len > 2 && !strcmp(name + len - 2, ".b")) out[len - 2] = 0;
+    else if (len > 3 && !strcmp(name + len - 3, ".bf")) out[len - 3] = 0;
+    else strcpy(out + len, ".out");
+    return out;
+}
+
+/* compile the program in the file <name> */
+static int budgie_batch_job(const char *name, const struct budgie_batch_options *bopts) {
+    char *out_name;
+    int fd, rc;
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: Error reading input!\n", name);
+        return -__LINE__;
+    }
+    out_name = budgie_batch_output_name(name);
+    if (!out_name) {
+        fprintf(stderr, "%s: Error writing output!\n", name);
+        close(fd);
+        return -__LINE__;
+    }
+
+    rc = budgie_compile(fd, out_name, bopts->compile, name);
+
+    close(fd);
+    free(out_name);
+    return rc;
+}
+
+/* take programs off the list until there are none left */
+static void *budgie_batch_worker(void *arg) {
+    struct budgie_batch *batch;
+    size_t i;
+
+    batch = arg;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        i = batch->next < batch->n ? batch->next++ : batch->n;
+        pthread_mutex_unlock(&batch->lock);
+        if (i == batch->n) break;
+
+        if (budgie_batch_job(batch->names[i], batch->bopts)) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failed = 1;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+    return NULL;
+}
+
+int budgie_batch_compile(char **names, size_t n, const struct budgie_batch_options *bopts) {
+    struct budgie_batch batch;
+    pthread_t *threads;
+    size_t i, jobs;
+
+    batch.names = names;
+    batch.n = n;
+    batch.next = 0;
+    batch.failed = 0;
+    batch.bopts = bopts;
+    if (pthread_mutex_init(&batch.lock, NULL)) return -__LINE__;
+
+    /* no more threads than there are programs, and with just one, compile
+     * them right here */
+    jobs = bopts->jobs > 0 ? (size_t)bopts->jobs : 1;
+    if (jobs > n) jobs = n;
+    threads = jobs > 1 ? malloc(jobs * sizeof(*threads)) : NULL;
+    if (!threads) jobs = 1;
+
+    for (i = 1; i < jobs; i++) {
+        if (pthread_create(&threads[i], NULL, budgie_batch_worker, &batch)) break;
+    }
+    jobs = i;
+    budgie_batch_worker(&batch);
+    for (i = 1; i < jobs; i++) pthread_join(threads[i], NULL);
+
+    /* make room for everything that was just put in the cache, in one go */
+    if (bopts->compile->cache && budgie_cache_evict(bopts->compile->cache)) {
+        fprintf(stderr, "Couldn't make room in the cache\n");
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&batch.lock);
+    return batch.failed ? -__LINE__ : 0;
+}
@@ -0,0 +1,509 @@
+/* this file keeps executables around between compiles, named after a hash
+ * of everything that goes into them, so compiling the same program the same
+ * way again is just a matter of handing out the one from last time */
+#define _POSIX_C_SOURCE 199506L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <rudolph/buffer.h>
+#include "cache.h"
+#include "options.h"
+#include "sha256.h"
+
+#define BUDGIE_CACHE_VERSION 1 /* bump when the key changes meaning */
+#define BUDGIE_CACHE_CHUNK 65536 /* bytes read at a time */
+#define BUDGIE_CACHE_TRIES 64 /* names to try for a file being written */
+
+/* an entry, when working out which ones to drop */
+struct budgie_cache_entry {
+    char name[BUDGIE_CACHE_KEY_LEN + 1];
+    time_t used; /* when it was last handed out (its mtime) */
+    size_t size;
+};
+
+/* <dir>/<name>, which has to be freed */
+static char *budgie_cache_path(const char *dir, const char *name) {
+    char *path;
+
+    path = malloc(strlen(dir) + strlen(name) + 2);
+    if (path) sprintf(path, "%s/%s", dir, name);
+    return path;
+}
+
+/* mkdir -p */
+static int budgie_cache_mkdir(char *dir) {
+    char *p;
+
+    for (p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = 0;
+        if (mkdir(dir, 0777) && errno != EEXIST) {
+            *p = '/';
+            return -__LINE__;
+        }
+        *p = '/';
+    }
+    if (mkdir(dir, 0777) && errno != EEXIST) return -__LINE__;
+    return 0;
+}
+
+char *budgie_cache_default_dir(void) {
+    const char *base;
+    char *dir;
+
+    base = getenv("XDG_CACHE_HOME");
+    if (base && *base) return budgie_cache_path(base, "budgie");
+    base = getenv("HOME");
+    if (!base || !*base) return NULL;
+    dir = malloc(strlen(base) + sizeof("/.cache/budgie"));
+    if (dir) sprintf(dir, "%s/.cache/budgie", base);
+    return dir;
+}
+
+int budgie_cache_open(struct budgie_cache *cache, const char *dir, size_t max_size) {
+    cache->max_size = max_size;
+    cache->dir = malloc(strlen(dir) + 1);
+    if (!cache->dir) return -__LINE__;
+    strcpy(cache->dir, dir);
+
+    if (budgie_cache_mkdir(cache->dir)) {
+        budgie_cache_close(cache);
+        return -__LINE__;
+    }
+    return 0;
+}
+
+void budgie_cache_close(struct budgie_cache *cache) {
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+/* hash everything left in <fd> */
+static int budgie_cache_hash_fd(struct budgie_sha256 *ctx, int fd) {
+    unsigned char buf[BUDGIE_CACHE_CHUNK];
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) budgie_sha256_update(ctx, buf, n);
+    return n < 0 ? -__LINE__ : 0;
+}
+
+int budgie_cache_key(int fd, const struct budgie_options *opts, const char *target, int optimize,
+                     size_t peval_steps, const char *profile, char key[BUDGIE_CACHE_KEY_LEN + 1]) {
+    struct budgie_sha256 ctx;
+    unsigned char hash[BUDGIE_SHA256_LEN];
+    char desc[256];
+    struct stat st;
+    int i, prof_fd;
+
+    /* the source gets read twice, so it can't be a pipe */
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) return -__LINE__;
+
+    /* a different budgie might compile the same thing differently, so which
+     * one this is is part of the key. rebuilding it changes at least its
+     * modification time */
+    if (stat("/proc/self/exe", &st)) return -__LINE__;
+    budgie_sha256_init(&ctx);
+    sprintf(desc, "budgie cache %d\n%lu %lu %lu %lu\n", BUDGIE_CACHE_VERSION, (unsigned long)st.st_dev,
+            (unsigned long)st.st_ino, (unsigned long)st.st_size, (unsigned long)st.st_mtime);
+    budgie_sha256_update(&ctx, desc, strlen(desc));
+
+    /* then every option that changes the executable */
+    sprintf(desc, "%.32s %d %d %d %lu %d %d %lu %d %d %d\n", target, (int)opts->io_buffer, (int)opts->eof,
+            (int)opts->tape, (unsigned long)opts->tape_size, opts->cell_size, optimize,
+            (unsigned long)peval_steps, (int)opts->align, opts->align_bytes, opts->instrument != NULL);
+    budgie_sha256_update(&ctx, desc, strlen(desc));
+    if (opts->instrument) budgie_sha256_update(&ctx, opts->instrument, strlen(opts->instrument) + 1);
+
+    /* and the profile, which changes it too (if it can be read at all) */
+    prof_fd = profile ? open(profile, O_RDONLY) : -1;
+    if (prof_fd >= 0) {
+        if (fstat(prof_fd, &st) || budgie_cache_hash_fd(&ctx, prof_fd)) {
+            close(prof_fd);
+            return -__LINE__;
+        }
+        close(prof_fd);
+        sprintf(desc, "profile %lu\n", (unsigned long)st.st_size);
+    } else {
+        sprintf(desc, "no profile\n");
+    }
+    budgie_sha256_update(&ctx, desc, strlen(desc));
+
+    /* and of course the source */
+    if (budgie_cache_hash_fd(&ctx, fd) || lseek(fd, 0, SEEK_SET)) return -__LINE__;
+
+    budgie_sha256_final(&ctx, hash);
+    for (i = 0; i < BUDGIE_SHA256_LEN; i++) sprintf(key + 2 * i, "%02x", hash[i]);
+    return 0;
+}
+
+/* copy all of <in> to <out> */
+static int budgie_cache_copy(int in, int out) {
+    unsigned char buf[BUDGIE_CACHE_CHUNK];
+    ssize_t n, w;
+    size_t done;
+
+    /* have the kernel do it if it can */
+    while ((n = sendfile(out, in, NULL, BUDGIE_CACHE_CHUNK)) > 0);
+    if (n == 0) return 0;
+    if (errno != EINVAL && errno != ENOSYS) return -__LINE__;
+
+    /* otherwise, the hard way */
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        for (done = 0; done < (size_t)n; done += w) {
+            w = write(out, buf + done, n - done);
+            if (w <= 0) return -__LINE__;
+        }
+    }
+    return n < 0 ? -__LINE__ : 0;
+}
+
+int budgie_cache_get(const struct budgie_cache *cache, const char *key, const char *out_name) {
+    char *path;
+    struct stat st;
+    int fd, out, rc;
+
+    path = budgie_cache_path(cache->dir, key);
+    if (!path) return -__LINE__;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        rc = errno == ENOENT ? 1 : -__LINE__; /* before free gets to errno */
+        free(path);
+        return rc;
+    }
+
+    /* it was used just now, so it's the last to go */
+    utime(path, NULL);
+
+    /* a copy, not a link: the output is the user's to strip or touch, and
+     * none of that should reach the entry (or the entry's mtime the output) */
+    rc = 0;
+    if (!out_name) {
+        if (budgie_cache_copy(fd, fileno(stdout))) rc = -__LINE__;
+    } else {
+        out = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0777);
+        if (out < 0 || budgie_cache_copy(fd, out)) rc = -__LINE__;
+
+        /* a file that was already there keeps its mode, so make it
+         * executable the same way main.c does */
+        if (!rc && !fstat(out, &st)) fchmod(out, st.st_mode | S_IXUSR | S_IXGRP | S_IXOTH);
+        if (out >= 0 && close(out) && !rc) rc = -__LINE__;
+    }
+
+    close(fd);
+    free(path);
+    return rc;
+}
+
+/* oldest first */
+static int budgie_cache_entry_cmp(const void *a, const void *b) {
+    time_t x, y;
+
+    x = ((const struct budgie_cache_entry *)a)->used;
+    y = ((const struct budgie_cache_entry *)b)->used;
+    return x < y ? -1 : x > y;
+}
+
+/* whether <name> is a key (and not a file being written, or anything else) */
+static int budgie_cache_is_key(const char *name) {
+    size_t i;
+
+    for (i = 0; i < BUDGIE_CACHE_KEY_LEN; i++) {
+        if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f'))) return 0;
+    }
+    return !name[i];
+}
+
+int budgie_cache_evict(const struct budgie_cache *cache) {
+    struct budgie_cache_entry *entries, *grown;
+    struct dirent *ent;
+    struct stat st;
+    size_t n, cap, total, i;
+    time_t now;
+    char *path;
+    DIR *dir;
+
+    dir = opendir(cache->dir);
+    if (!dir) return -__LINE__;
+
+    entries = NULL;
+    n = cap = total = 0;
+    now = time(NULL);
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') continue;
+        path = budgie_cache_path(cache->dir, ent->d_name);
+        if (!path) break;
+        if (stat(path, &st)) {
+            /* someone else dropped it already */
+            free(path);
+            continue;
+        }
+
+        if (!budgie_cache_is_key(ent->d_name)) {
+            /* a half-written entry from a budgie that never finished */
+            if (!strncmp(ent->d_name, "tmp-", 4) && now - st.st_mtime > BUDGIE_CACHE_STALE) unlink(path);
+            free(path);
+            continue;
+        }
+        free(path);
+
+        if (n == cap) {
+            cap = cap ? 2 * cap : 64;
+            grown = realloc(entries, cap * sizeof(*entries));
+            if (!grown) break;
+            entries = grown;
+        }
+        strcpy(entries[n].name, ent->d_name);
+        entries[n].used = st.st_mtime;
+        entries[n].size = st.st_size;
+        total += st.st_size;
+        n++;
+    }
+    closedir(dir);
+
+    if (total > cache->max_size) {
+        qsort(entries, n, sizeof(*entries), budgie_cache_entry_cmp);
+        for (i = 0; i < n && total > cache->max_size; i++) {
+            path = budgie_cache_path(cache->dir, entries[i].name);
+            if (!path) break;
+            unlink(path); /* if another budgie got to it first, that's fine */
+            total -= entries[i].size;
+            free(path);
+        }
+    }
+
+    free(entries);
+    return 0;
+}
+
+int budgie_cache_put(const struct budgie_cache *cache, const char *key, rd_buf_t *exe) {
+    char name[BUDGIE_CACHE_KEY_LEN + 32], *tmp, *path;
+    const unsigned char *pos;
+    size_t len;
+    ssize_t n;
+    int fd, rc, try;
+
+    path = budgie_cache_path(cache->dir, key);
+    tmp = malloc(strlen(cache->dir) + sizeof(name) + 1);
+    if (!tmp || !path) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* write it under a name of its own, and only then move it into place,
+     * so nobody ever sees half of it. other threads of this budgie, or a
+     * budgie that crashed with the same pid, might be using the first few
+     * names, so keep going until one is free */
+    fd = -1;
+    for (try = 0; fd < 0 && try < BUDGIE_CACHE_TRIES; try++) {
+        sprintf(name, "tmp-%lu-%d-%.64s", (unsigned long)getpid(), try, key);
+        sprintf(tmp, "%s/%s", cache->dir, name);
+        fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0555); /* entries are never written again */
+        if (fd < 0 && errno != EEXIST) break;
+        /* and if someone else got it in already, there's nothing to do */
+        if (fd < 0 && !access(path, F_OK)) {
+            rc = 0;
+            goto cleanup;
+        }
+    }
+    if (fd < 0) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    rc = 0;
+    pos = rd_buffer_data(exe);
+    for (len = exe->len; len; pos += n, len -= n) {
+        n = write(fd, pos, len);
+        if (n <= 0) {
+            rc = -__LINE__;
+            break;
+        }
+    }
+    if (close(fd) && !rc) rc = -__LINE__;
+    if (!rc && rename(tmp, path)) rc = -__LINE__;
+    if (rc) unlink(tmp);
+
+cleanup:
+    free(tmp);
+    free(path);
+    return rc;
+}
+
+/* debug code - to use, compile with
+ * `gcc src/cache.c src/sha256.c -Iinclude/ -Idist/librudolph/include/ -Wall -Werror \
+     -g -ansi -pedantic -Ldist/ -lrudolph -DRUDOLF_USE_STDLIB -D__CACHE_DEBUG` */
+#ifdef __CACHE_DEBUG
+#define TEST_EXE_LEN 8
+
+/* a key made of just <c> */
+void make_key(char key[BUDGIE_CACHE_KEY_LEN + 1], char c) {
+    memset(key, c, BUDGIE_CACHE_KEY_LEN);
+    key[BUDGIE_CACHE_KEY_LEN] = 0;
+}
+
+/* put an executable that's just <data> in the cache */
+void put_exe(const struct budgie_cache *cache, const char *key, const char *data) {
+    rd_buf_t *exe = NULL;
+
+    rd_buffer_push(&exe, (const unsigned char *)data, strlen(data));
+    if (budgie_cache_put(cache, key, exe)) printf("warning: couldn't put `%s'\n", data);
+    rd_buffer_free(exe);
+}
+
+/* whether the file <name> holds just <data> */
+int has_exe(const char *name, const char *data) {
+    char buf[64];
+    size_t n;
+    FILE *fp;
+
+    fp = fopen(name, "rb");
+    if (!fp) return 0;
+    n = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+    return n == strlen(data) && !memcmp(buf, data, n);
+}
+
+/* set when the entry <key> was last used */
+void set_used(const struct budgie_cache *cache, const char *key, time_t when) {
+    struct utimbuf times;
+    char *path;
+
+    times.actime = times.modtime = when;
+    path = budgie_cache_path(cache->dir, key);
+    utime(path, &times);
+    free(path);
+}
+
+/* whether there's an entry for <key> */
+int has_entry(const struct budgie_cache *cache, const char *key) {
+    char *path;
+    int rc;
+
+    path = budgie_cache_path(cache->dir, key);
+    rc = !access(path, F_OK);
+    free(path);
+    return rc;
+}
+
+/* empty the directory <name> and remove it */
+void remove_dir(const char *name) {
+    struct dirent *ent;
+    char *path;
+    DIR *dir;
+
+    dir = opendir(name);
+    if (!dir) return;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') continue;
+        path = budgie_cache_path(name, ent->d_name);
+        unlink(path);
+        free(path);
+    }
+    closedir(dir);
+    rmdir(name);
+}
+
+int main() {
+    struct budgie_cache cache, broken;
+    char key_a[BUDGIE_CACHE_KEY_LEN + 1], key_b[BUDGIE_CACHE_KEY_LEN + 1];
+    char key_c[BUDGIE_CACHE_KEY_LEN + 1], key_d[BUDGIE_CACHE_KEY_LEN + 1];
+    char dir[64], name[BUDGIE_CACHE_KEY_LEN + 32], *path, *entry;
+    struct utimbuf times;
+    struct stat out_st, entry_st;
+    FILE *fp;
+
+    sprintf(dir, "budgie-cache-test-%lu", (unsigned long)getpid());
+    make_key(key_a, 'a');
+    make_key(key_b, 'b');
+    make_key(key_c, 'c');
+    make_key(key_d, 'd');
+    if (budgie_cache_open(&cache, dir, 3 * TEST_EXE_LEN)) {
+        printf("warning: couldn't open the cache\n");
+        return 1;
+    }
+
+    /* nothing there yet is a miss */
+    if (budgie_cache_get(&cache, key_a, "test-out") != 1) printf("warning: an empty cache didn't miss\n");
+
+    /* but a cache that can't be read at all isn't */
+    path = budgie_cache_path(dir, "not-a-dir");
+    fp = fopen(path, "w");
+    if (fp) fclose(fp);
+    broken.dir = path;
+    if (budgie_cache_get(&broken, key_a, "test-out") >= 0) printf("warning: an error came out as a miss\n");
+    unlink(path);
+    free(path);
+
+    /* what's handed out is a copy, so changing it leaves the entry alone */
+    put_exe(&cache, key_a, "budgie-a");
+    if (budgie_cache_get(&cache, key_a, "test-out") || !has_exe("test-out", "budgie-a")) {
+        printf("warning: didn't get back what was put\n");
+    }
+    entry = budgie_cache_path(dir, key_a);
+    stat("test-out", &out_st);
+    stat(entry, &entry_st);
+    if (out_st.st_ino == entry_st.st_ino) printf("warning: the output is the entry\n");
+    fp = fopen("test-out", "wb");
+    if (fp) {
+        fputs("stripped", fp);
+        fclose(fp);
+    }
+    if (!has_exe(entry, "budgie-a")) printf("warning: changing the output changed the entry\n");
+
+    /* and using the entry again doesn't touch what was handed out before */
+    times.actime = times.modtime = 1000;
+    utime("test-out", &times);
+    budgie_cache_get(&cache, key_a, "test-out2");
+    stat("test-out", &out_st);
+    if (out_st.st_mtime != 1000) printf("warning: a hit changed an older output\n");
+    unlink("test-out");
+    unlink("test-out2");
+    free(entry);
+
+    /* a file some other budgie left behind doesn't stop a put */
+    sprintf(name, "tmp-%lu-0-%s", (unsigned long)getpid(), key_d);
+    path = budgie_cache_path(dir, name);
+    fp = fopen(path, "w");
+    if (fp) fclose(fp);
+    put_exe(&cache, key_d, "budgie-d");
+    if (!has_entry(&cache, key_d)) printf("warning: a leftover file stopped a put\n");
+
+    /* puts never drop anything, even past the size */
+    put_exe(&cache, key_b, "budgie-b");
+    put_exe(&cache, key_c, "budgie-c");
+    if (!has_entry(&cache, key_a) || !has_entry(&cache, key_b) || !has_entry(&cache, key_c)
+            || !has_entry(&cache, key_d)) {
+        printf("warning: a put dropped an entry\n");
+    }
+
+    /* evicting drops the ones used least recently until the rest fit, and
+     * leftovers once they're old enough */
+    set_used(&cache, key_a, 100);
+    set_used(&cache, key_b, 400);
+    set_used(&cache, key_c, 300);
+    set_used(&cache, key_d, 200);
+    times.actime = times.modtime = 0;
+    utime(path, &times);
+    if (budgie_cache_evict(&cache)) printf("warning: couldn't evict\n");
+    if (has_entry(&cache, key_a)) printf("warning: the oldest entry is still there\n");
+    if (!has_entry(&cache, key_b) || !has_entry(&cache, key_c) || !has_entry(&cache, key_d)) {
+        printf("warning: evicted more than it had to\n");
+    }
+    if (!access(path, F_OK)) printf("warning: an old leftover is still there\n");
+    free(path);
+
+    remove_dir(dir);
+    budgie_cache_close(&cache);
+    printf("done\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,179 @@
+/* this file is what compiling a program takes, from reading the source to
+ * writing the executable. main.c compiles one program with it, and batch.c
+ * every program in a batch, so both go through the very same steps */
+#define _POSIX_C_SOURCE 199506L
+#include <stdio.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <rudolph/buffer.h>
+#include "compile.h"
+#include "stats.h"
+
+/* print a message about the program <name>, or just the message if that's
+ * NULL, in one piece even if other threads are printing too */
+static void budgie_compile_msg(const char *name, const char *fmt, ...) {
+    va_list ap;
+
+    flockfile(stderr);
+    if (name) fprintf(stderr, "%s: ", name);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    funlockfile(stderr);
+}
+
+/* write <exe> to the file <name> and make it executable, or to stdout if
+ * <name> is NULL */
+static int budgie_compile_write(const char *name, rd_buf_t *exe) {
+    const unsigned char *pos;
+    struct stat st;
+    size_t len;
+    ssize_t n;
+    int fd, rc;
+
+    fd = name ? open(name, O_WRONLY | O_CREAT | O_TRUNC, 0777) : fileno(stdout);
+    if (fd < 0) return -__LINE__;
+
+    rc = 0;
+    pos = rd_buffer_data(exe);
+    for (len = exe->len; len; pos += n, len -= n) {
+        n = write(fd, pos, len);
+        if (n <= 0) {
+            rc = -__LINE__;
+            break;
+        }
+    }
+
+    /* a file that was already there keeps its mode */
+    if (name) {
+        if (!rc && !fstat(fd, &st)) fchmod(fd, st.st_mode | S_IXUSR | S_IXGRP | S_IXOTH);
+        if (close(fd) && !rc) rc = -__LINE__;
+    }
+    return rc;
+}
+
+int budgie_compile_ir(int fd, const struct budgie_compile_options *copts, const char *name,
+                      struct budgie_program *prog) {
+    struct budgie_stats *stats;
+    size_t nbytes;
+    int rc;
+
+    prog->opts = *copts->opts;
+    prog->ir = NULL;
+    budgie_loops_init(&prog->loops);
+    prog->peval.tape = prog->peval.output = NULL;
+    prog->profile.counts = NULL;
+    stats = prog->opts.stats;
+
+    /* "compile" the code to an IR as it comes in */
+    rc = budgie_parse_fd(fd, &prog->ir, &prog->loops, &nbytes);
+    if (rc) {
+        budgie_compile_msg(name, "Syntax error in input!\n");
+        return rc;
+    }
+    if (stats) {
+        budgie_stats_phase(stats, BSP_PARSE);
+        stats->input_bytes = nbytes;
+        stats->ir_bytes_before = prog->ir->len;
+        budgie_stats_count(prog->ir, stats->ops_before);
+        budgie_stats_mark(stats);
+    }
+
+    /* optimize */
+    if (copts->optimize) {
+        rc = budgie_oplist_optimize(&prog->ir, &prog->loops, stats);
+        if (rc) goto error;
+    }
+
+    /* run as much of it as doesn't need any input right now */
+    if (copts->optimize && copts->peval_steps) {
+        rc = budgie_peval(&prog->ir, &prog->loops, copts->peval_steps,
+                          prog->opts.tape_size - BUDGIE_TAPE_START(&prog->opts), prog->opts.cell_size,
+                          &prog->peval, stats);
+        if (rc) goto error;
+        prog->opts.start = &prog->peval;
+    }
+    if (stats) {
+        budgie_stats_phase(stats, BSP_OPTIMIZE);
+        stats->ir_bytes_after = prog->ir->len;
+        budgie_stats_count(prog->ir, stats->ops_after);
+        budgie_stats_mark(stats);
+    }
+
+    /* go by how an instrumented run of the very same program went */
+    if (copts->profile) {
+        if (budgie_profile_read(copts->profile, &prog->profile)) {
+            budgie_compile_msg(name, "Can't read profile `%s', ignoring it\n", copts->profile);
+        } else if (prog->profile.hash != budgie_profile_hash(prog->ir)) {
+            budgie_compile_msg(name, "Profile `%s' is for a different program, ignoring it\n", copts->profile);
+        } else {
+            prog->opts.profile = &prog->profile;
+        }
+    }
+    return 0;
+
+error:
+    budgie_compile_msg(name, "Error %d occurred :(\n", rc);
+    return rc;
+}
+
+void budgie_program_free(struct budgie_program *prog) {
+    rd_buffer_free(prog->ir);
+    prog->ir = NULL;
+    budgie_loops_free(&prog->loops);
+    budgie_peval_free(&prog->peval);
+    budgie_profile_free(&prog->profile);
+}
+
+int budgie_compile(int fd, const char *out_name, const struct budgie_compile_options *copts,
+                   const char *name) {
+    struct budgie_program prog;
+    struct budgie_stats *stats;
+    char key[BUDGIE_CACHE_KEY_LEN + 1];
+    rd_buf_t *final;
+    int rc, keyed;
+
+    final = NULL;
+    keyed = 0;
+    stats = copts->opts->stats;
+
+    /* hand out the executable from last time, if there is one. with stats,
+     * compile it anyway so there's something to show */
+    if (copts->cache) {
+        keyed = !budgie_cache_key(fd, copts->opts, copts->backend->name, copts->optimize, copts->peval_steps,
+                                  copts->profile, key);
+        if (keyed && !stats && !budgie_cache_get(copts->cache, key, out_name)) return 0;
+    }
+
+    rc = budgie_compile_ir(fd, copts, name, &prog);
+    if (rc) goto cleanup;
+
+    rc = copts->backend->translate(prog.ir, &prog.opts, &final);
+    if (stats) budgie_stats_phase(stats, BSP_TRANSLATE);
+    if (rc) {
+        budgie_compile_msg(name, "Error %d occurred :(\n", rc);
+        goto cleanup;
+    }
+
+    rc = budgie_compile_write(out_name, final);
+    if (rc) {
+        budgie_compile_msg(name, "Error writing output!\n");
+        goto cleanup;
+    }
+    if (keyed && budgie_cache_put(copts->cache, key, final)) {
+        budgie_compile_msg(name, "Couldn't add the executable to the cache\n");
+    }
+
+    if (stats) {
+        budgie_stats_phase(stats, BSP_WRITE);
+        stats->output_bytes = final->len;
+    }
+
+cleanup:
+    budgie_program_free(&prog);
+    rd_buffer_free(final);
+    return rc;
+}
@@ -0,0 +1,276 @@
+/* this file runs programs without generating any machine code at all, for
+ * when writing or mapping executable code isn't allowed, and to have
+ * something simple to check the compiled code against.
+ *
+ * the oplist is decoded up front into an array of fixed-size instructions,
+ * with the target of every loop jump already worked out. with gcc, each
+ * instruction then holds the address of its handler, and every handler jumps
+ * straight to the next one's (computed goto); other compilers go through a
+ * switch instead */
+#define _POSIX_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <rudolph/buffer.h>
+#include "ir.h"
+#include "interp.h"
+#include "options.h"
+#include "peval.h"
+
+#define BUDGIE_INTERP_OUTBUF_SZ 65536
+#define BUDGIE_INTERP_INBUF_SZ 65536
+
+/* what the interpreter runs. moves both ways and arithmetic both ways are
+ * one instruction each, with a signed arg */
+enum budgie_insn_type {
+    BIT_MOVE, /* move by arg */
+    BIT_ADD, /* add arg to the cell off away */
+    BIT_SET, /* set the cell off away to arg */
+    BIT_MULA, /* add the cell src away times arg to the cell off away */
+    BIT_OUT, /* write the cell off away */
+    BIT_IN, /* read into the cell off away */
+    BIT_LOPEN, /* if the cell is 0, jump to instruction arg */
+    BIT_LCLOS, /* if the cell isn't 0, jump to instruction arg */
+    BIT_SCAN, /* move by arg until the cell is 0 */
+    BIT_END /* the program is done */
+};
+
+struct budgie_insn {
+#ifdef __GNUC__
+    const void *label; /* the handler for this instruction */
+#endif
+    enum budgie_insn_type type;
+    int32_t arg;
+    int32_t off;
+    int32_t src;
+};
+
+/* buffers for the program's input and output */
+struct budgie_interp_io {
+    size_t out_len; /* bytes waiting in out */
+    size_t out_max; /* flush once out_len gets here */
+    size_t in_pos; /* next unread byte in in */
+    size_t in_len; /* end of what was read into in */
+    size_t in_max; /* how much to read at a time */
+    int line; /* 1 to flush on every newline */
+    enum budgie_eof eof;
+    unsigned char out[BUDGIE_INTERP_OUTBUF_SZ];
+    unsigned char in[BUDGIE_INTERP_INBUF_SZ];
+};
+
+/* write <len> bytes from <pos> to stdout. short writes continue where they
+ * left off, and on error whatever is left is dropped, same as compiled
+ * programs */
+static void budgie_interp_write(const unsigned char *pos, size_t len) {
+    ssize_t n;
+
+    for (; len; pos += n, len -= n) {
+        n = write(1, pos, len);
+        if (n <= 0) break;
+    }
+}
+
+static void budgie_interp_flush(struct budgie_interp_io *io) {
+    budgie_interp_write(io->out, io->out_len);
+    io->out_len = 0;
+}
+
+/* refill the input buffer and return the next byte, or -1 at eof */
+static int budgie_interp_getc(struct budgie_interp_io *io) {
+    ssize_t n;
+
+    /* we're about to block, so anything written so far has to be visible */
+    budgie_interp_flush(io);
+
+    n = read(0, io->in, io->in_max);
+    io->in_pos = 0;
+    if (n <= 0) {
+        /* leave the buffer empty so the next `,` tries again */
+        io->in_len = 0;
+        return -1;
+    }
+    io->in_len = n;
+    return io->in[io->in_pos++];
+}
+
+__inline static size_t budgie_interp_abs(int32_t x) {
+    return x < 0 ? -(size_t)x : (size_t)x;
+}
+
+/* decode an oplist into instructions, ending with a BIT_END. <pad> is set to
+ * the furthest away from the cell pointer any instruction reaches */
+static int budgie_interp_decode(rd_buf_t *in, struct budgie_insn **out, size_t *pad) {
+    struct budgie_insn *code, *insn;
+    struct budgie_op op;
+    size_t *lopen;
+    unsigned char *ops;
+    size_t i, n, nloops;
+    int rc;
+
+    ops = rd_buffer_data(in);
+    code = NULL;
+    lopen = NULL;
+    *pad = 0;
+    rc = 0;
+
+    /* count the instructions and loops first, so they can go in arrays */
+    for (i = n = nloops = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        if (op.type != BOPT_NOOP) n++;
+        if (op.type == BOPT_F_LOPEN && (size_t)op.arg >= nloops) nloops = op.arg + 1;
+    }
+
+    /* loop jumps are stored as instruction numbers in an arg */
+    if (n >= BUDGIE_MAX_ARG) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* where each loop's LOPEN ended up, by the loop's index */
+    code = malloc((n + 1) * sizeof(*code));
+    lopen = malloc((nloops + 1) * sizeof(*lopen));
+    if (!code || !lopen) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    for (i = 0, insn = code; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        insn->arg = op.arg;
+        insn->off = op.off;
+        insn->src = op.src;
+
+        switch (op.type) {
+        case BOPT_P_NEXT:   insn->type = BIT_MOVE; break;
+        case BOPT_P_PREV:   insn->type = BIT_MOVE; insn->arg = -op.arg; break;
+        case BOPT_D_INCR:   insn->type = BIT_ADD; break;
+        case BOPT_D_DECR:   insn->type = BIT_ADD; insn->arg = -op.arg; break;
+        case BOPT_D_OUT:    insn->type = BIT_OUT; break;
+        case BOPT_D_IN:     insn->type = BIT_IN; break;
+        case BOPT_D_SET:    insn->type = BIT_SET; break;
+        case BOPT_D_MULA:   insn->type = BIT_MULA; break;
+        case BOPT_P_SCAN:   insn->type = BIT_SCAN; break;
+        case BOPT_F_LOPEN:
+            insn->type = BIT_LOPEN;
+            lopen[op.arg] = insn - code;
+            break;
+        case BOPT_F_LCLOS:
+            if ((size_t)op.arg >= nloops) {
+                rc = -__LINE__;
+                goto cleanup;
+            }
+            /* each end of the loop jumps to just past the other */
+            insn->type = BIT_LCLOS;
+            insn->arg = lopen[op.arg] + 1;
+            code[lopen[op.arg]].arg = insn - code + 1;
+            break;
+        case BOPT_NOOP: continue;
+        default:
+            rc = -__LINE__;
+            goto cleanup;
+        }
+
+        if (budgie_interp_abs(insn->off) > *pad) *pad = budgie_interp_abs(insn->off);
+        if (budgie_interp_abs(insn->src) > *pad) *pad = budgie_interp_abs(insn->src);
+        insn++;
+    }
+
+    insn->type = BIT_END;
+
+cleanup:
+    if (rc) {
+        free(code);
+        code = NULL;
+    }
+    *out = code;
+    free(lopen);
+    return rc;
+}
+
+#ifdef __GNUC__
+/* jump straight to the handler of the instruction at ip */
+#define BUDGIE_DISPATCH         __extension__ ({ goto *ip->label; })
+#define BUDGIE_HANDLER(type)    h_##type
+#else
+/* go back around to the switch */
+#define BUDGIE_DISPATCH         goto dispatch
+#define BUDGIE_HANDLER(type)    case type
+#endif
+
+#define BUDGIE_CELL             unsigned char
+#define BUDGIE_INTERP_EXEC      budgie_interp_exec8
+#include "interp_exec.h"
+#undef BUDGIE_CELL
+#undef BUDGIE_INTERP_EXEC
+
+#define BUDGIE_CELL             uint16_t
+#define BUDGIE_INTERP_EXEC      budgie_interp_exec16
+#include "interp_exec.h"
+#undef BUDGIE_CELL
+#undef BUDGIE_INTERP_EXEC
+
+#define BUDGIE_CELL             uint32_t
+#define BUDGIE_INTERP_EXEC      budgie_interp_exec32
+#include "interp_exec.h"
+#undef BUDGIE_CELL
+#undef BUDGIE_INTERP_EXEC
+
+int budgie_interp_run(rd_buf_t *in, const struct budgie_options *opts) {
+    struct budgie_insn *code;
+    struct budgie_interp_io *io;
+    unsigned char *tape, *cells;
+    size_t pad, ncells, start, sz;
+    int rc;
+
+    tape = NULL;
+    io = NULL;
+
+    rc = budgie_interp_decode(in, &code, &pad);
+    if (rc) return rc;
+
+    /* the cell pointer is only checked when it moves, so leave enough room on
+     * both sides of the tape for the furthest any instruction reaches */
+    ncells = opts->tape_size;
+    sz = opts->cell_size;
+    if (pad > ((size_t)-1 / sz - ncells) / 2) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    tape = calloc(ncells + 2 * pad, sz);
+    io = malloc(sizeof(*io));
+    if (!tape || !io) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    cells = tape + pad * sz;
+
+    /* without buffering, every byte is written on its own, and only a single
+     * byte is read at a time so nothing past what the program reads gets
+     * taken from stdin */
+    io->out_len = 0;
+    io->out_max = opts->io_buffer == BIOB_NONE ? 1 : BUDGIE_INTERP_OUTBUF_SZ;
+    io->in_pos = io->in_len = 0;
+    io->in_max = opts->io_buffer == BIOB_NONE ? 1 : BUDGIE_INTERP_INBUF_SZ;
+    io->line = opts->io_buffer == BIOB_LINE;
+    io->eof = opts->eof;
+
+    /* pick up where running the program at compile time left off */
+    start = BUDGIE_TAPE_START(opts);
+    if (opts->start) {
+        memcpy(cells + start * sz, rd_buffer_data(opts->start->tape), opts->start->tape->len);
+        budgie_interp_write(rd_buffer_data(opts->start->output), opts->start->output->len);
+        start += opts->start->pos;
+    }
+
+    /* the cells are aligned, since calloc's memory is aligned for anything */
+    if (sz == 1) rc = budgie_interp_exec8(code, io, cells, ncells, start);
+    else if (sz == 2) rc = budgie_interp_exec16(code, io, (uint16_t *)(void *)cells, ncells, start);
+    else rc = budgie_interp_exec32(code, io, (uint32_t *)(void *)cells, ncells, start);
+
+cleanup:
+    free(io);
+    free(tape);
+    free(code);
+    return rc;
+}
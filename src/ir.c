@@ -1,24 +1,168 @@
 /* this file parses the brainfuck input into an IR and optimizes the IR */
+#define _POSIX_SOURCE
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "stack.h"
 #include "ir.h"
+#include "stats.h"
 
-int budgie_oplist_create(rd_buf_t *in, rd_buf_t **out) {
-    size_t n, i, m;
-    int rc, d;
-    struct budgie_op cur_op, *last_op;
-    unsigned char *buf;
+#define READBUF_SZ  1048576
+#define MAPWIN_SZ   16777216 /* a multiple of the page size */
+#define PRESIZE_MAX 67108864 /* most to allocate for an oplist up front */
+
+/* zigzag-encode <v> so small negative numbers stay small, then write it out
+ * 7 bits at a time, lowest first, with the top bit set on all but the last
+ * byte. returns the number of bytes written (at most 5) */
+static size_t budgie_varint_encode(int32_t v, unsigned char *out) {
+    uint32_t z;
+    size_t n;
+
+    z = v < 0 ? ~((uint32_t)v << 1) : (uint32_t)v << 1;
+    for (n = 0; z >= 0x80; n++) {
+        out[n] = (z & 0x7F) | 0x80;
+        z >>= 7;
+    }
+    out[n++] = z;
+
+    return n;
+}
+
+static size_t budgie_varint_decode(const unsigned char *in, int32_t *v) {
+    uint32_t z;
+    size_t n;
+    int shift;
+
+    z = 0;
+    shift = 0;
+    n = 0;
+    do {
+        z |= (uint32_t)(in[n] & 0x7F) << shift;
+        shift += 7;
+    } while (in[n++] & 0x80);
+    *v = (z & 1) ? (int32_t)~(z >> 1) : (int32_t)(z >> 1);
+
+    return n;
+}
+
+size_t budgie_op_encode(const struct budgie_op *op, unsigned char *out) {
+    size_t n;
+
+    /* header, then only the operands that aren't the default */
+    out[0] = op->type & BOPH_TYPE;
+    n = 1;
+    if (op->arg != 1) {
+        out[0] |= BOPH_ARG;
+        n += budgie_varint_encode(op->arg, out + n);
+    }
+    if (op->off != 0) {
+        out[0] |= BOPH_OFF;
+        n += budgie_varint_encode(op->off, out + n);
+    }
+    if (op->src != 0) {
+        out[0] |= BOPH_SRC;
+        n += budgie_varint_encode(op->src, out + n);
+    }
+
+    return n;
+}
+
+size_t budgie_op_decode(const unsigned char *in, struct budgie_op *op) {
+    size_t n;
+
+    op->type = (enum budgie_op_type)(in[0] & BOPH_TYPE);
+    op->arg = 1;
+    op->off = op->src = 0;
+    n = 1;
+    if (in[0] & BOPH_ARG) n += budgie_varint_decode(in + n, &op->arg);
+    if (in[0] & BOPH_OFF) n += budgie_varint_decode(in + n, &op->off);
+    if (in[0] & BOPH_SRC) n += budgie_varint_decode(in + n, &op->src);
+
+    return n;
+}
+
+int budgie_op_push(rd_buf_t **out, const struct budgie_op *op) {
+    unsigned char enc[BUDGIE_MAX_OP_SZ];
+
+    return rd_buffer_push(out, enc, budgie_op_encode(op, enc));
+}
+
+void budgie_loops_init(struct budgie_loops *loops) {
+    loops->loop = NULL;
+    loops->n = loops->sz = 0;
+    loops->cur = BUDGIE_NO_LOOP;
+}
+
+void budgie_loops_free(struct budgie_loops *loops) {
+    free(loops->loop);
+    budgie_loops_init(loops);
+}
+
+long budgie_loops_open(struct budgie_loops *loops, size_t pos) {
+    struct budgie_loop *loop;
+    size_t sz;
+
+    /* the index has to fit in an op's arg */
+    if (loops->n >= BUDGIE_MAX_ARG) return -1;
+
+    if (loops->n == loops->sz) {
+        sz = loops->sz ? loops->sz * 2 : 64;
+        loop = realloc(loops->loop, sz * sizeof(*loop));
+        if (!loop) return -1;
+        loops->loop = loop;
+        loops->sz = sz;
+    }
+
+    loop = &loops->loop[loops->n];
+    loop->open = pos;
+    loop->close = 0; /* not known yet */
+    loop->parent = loops->cur;
+    loops->cur = loops->n;
+    return loops->n++;
+}
+
+long budgie_loops_close(struct budgie_loops *loops, size_t pos) {
+    size_t i;
+
+    if (loops->cur == BUDGIE_NO_LOOP) return -1;
+
+    i = loops->cur;
+    loops->loop[i].close = pos;
+    loops->cur = loops->loop[i].parent;
+    return i;
+}
+
+void budgie_loops_drop(struct budgie_loops *loops) {
+    loops->cur = loops->loop[--loops->n].parent;
+}
+
+void budgie_parser_init(struct budgie_parser *p, size_t hint) {
+    /* the oplist is hardly ever longer than the source, since runs of the
+     * same op are grouped and comments dropped, so allocating that much
+     * saves growing it over and over for big programs */
+    p->out = hint ? rd_buffer_initsz(hint < PRESIZE_MAX ? hint : PRESIZE_MAX) : rd_buffer_init();
+    p->nbytes = 0;
+    p->last_op.type = BOPT_NOOP; /* nothing being grouped yet */
+    budgie_loops_init(&p->loops);
+}
+
+int budgie_parser_feed(struct budgie_parser *p, const unsigned char *data, size_t len) {
+    size_t i;
+    long loop;
+    struct budgie_op cur_op;
 
     /* initial setup */
-    n = in->len;
-    *out = NULL;
-    m = d = 0;
-    buf = rd_buffer_data(in);
-    cur_op.arg = 1;
+    cur_op.off = 0;
+    cur_op.src = 0;
+    p->nbytes += len;
 
     /* loop through each character */
     /* at this step, we already perform the basic optimization of grouping instructions */
-    for (i = 0; i < n; i++) {
-        switch (buf[i]) {
+    for (i = 0; i < len; i++) {
+        cur_op.arg = 1;
+        switch (data[i]) {
         case '>':
             cur_op.type = BOPT_P_NEXT;
             goto groupinstr;
@@ -39,72 +183,561 @@ int budgie_oplist_create(rd_buf_t *in, rd_buf_t **out) {
             goto pushinstr;
         case '[':
             cur_op.type = BOPT_F_LOPEN;
-            d++;
             goto pushinstr;
         case ']':
             cur_op.type = BOPT_F_LCLOS;
-            if (--d < 0) {
-                /* stack pop returned null */
-                rc = -__LINE__;
-                goto cleanup;
-            }
             goto pushinstr;
         default: continue;
         }
     groupinstr:
         /* groupable instruction */
         /* check if last operation was the same as this one */
-        last_op = (struct budgie_op *)(rd_buffer_data(*out)) + m - 1;
-        if (m > 0 && last_op->type == cur_op.type && last_op->arg < BUDGIE_MAX_ARG) {
-            last_op->arg++;
+        if (p->last_op.type == cur_op.type && p->last_op.arg < BUDGIE_MAX_ARG) {
+            p->last_op.arg++;
             continue;
         }
+
+        /* different from last one, so push that one out and start grouping
+         * this one instead */
+        if (p->last_op.type != BOPT_NOOP) budgie_op_push(&p->out, &p->last_op);
+        p->last_op = cur_op;
+        continue;
     pushinstr:
-        /* non-groupable instruction or different from last one */
-        /* push the instruction to the array */
-        rd_buffer_push(out, (const unsigned char *)&cur_op, sizeof(cur_op));
+        /* non-groupable instruction */
+        /* push whatever was being grouped, then the instruction itself */
+        if (p->last_op.type != BOPT_NOOP) budgie_op_push(&p->out, &p->last_op);
+        p->last_op.type = BOPT_NOOP;
 
-        /* reset the argument */
-        cur_op.arg = 1;
+        /* loop brackets get the loop's index, and go in the loop table */
+        if (cur_op.type == BOPT_F_LOPEN) {
+            loop = budgie_loops_open(&p->loops, p->out->len);
+            if (loop < 0) return -__LINE__;
+            cur_op.arg = loop;
+        } else if (cur_op.type == BOPT_F_LCLOS) {
+            loop = budgie_loops_close(&p->loops, p->out->len);
+            if (loop < 0) {
+                /* too many closed ones */
+                return -__LINE__;
+            }
+            cur_op.arg = loop;
+        }
 
-        /* increment number of instructions pushed */
-        m++;
+        budgie_op_push(&p->out, &cur_op);
     }
 
+    return 0;
+}
+
+int budgie_parser_finish(struct budgie_parser *p, rd_buf_t **out, struct budgie_loops *loops) {
+    /* push the last group */
+    if (p->last_op.type != BOPT_NOOP) budgie_op_push(&p->out, &p->last_op);
+    p->last_op.type = BOPT_NOOP;
+
+    *out = p->out;
+    p->out = NULL;
+    *loops = p->loops;
+    budgie_loops_init(&p->loops);
+
     /* check number of braces */
-    if (d) {
+    if (loops->cur != BUDGIE_NO_LOOP) {
         /* too many open ones */
+        return -__LINE__;
+    }
+
+    /* no problemo */
+    return 0;
+}
+
+const char *budgie_op_name(enum budgie_op_type type) {
+    switch (type) {
+    case BOPT_P_NEXT: return "next";
+    case BOPT_P_PREV: return "prev";
+    case BOPT_D_INCR: return "incr";
+    case BOPT_D_DECR: return "decr";
+    case BOPT_D_OUT: return "out";
+    case BOPT_D_IN: return "in";
+    case BOPT_F_LOPEN: return "lopen";
+    case BOPT_F_LCLOS: return "lclos";
+    case BOPT_NOOP: return "noop";
+    case BOPT_D_SET: return "set";
+    case BOPT_D_MULA: return "mula";
+    case BOPT_P_SCAN: return "scan";
+    default: return NULL;
+    }
+}
+
+int budgie_oplist_create(rd_buf_t *in, rd_buf_t **out, struct budgie_loops *loops) {
+    struct budgie_parser p;
+    int rc, rc_finish;
+
+    budgie_parser_init(&p, in->len);
+    rc = budgie_parser_feed(&p, rd_buffer_data(in), in->len);
+    rc_finish = budgie_parser_finish(&p, out, loops);
+
+    return rc ? rc : rc_finish;
+}
+
+int budgie_parse_fd(int fd, rd_buf_t **out, struct budgie_loops *loops, size_t *nbytes) {
+    struct budgie_parser parser;
+    struct stat statinfo;
+    unsigned char *read_buf;
+    void *map;
+    off_t pos;
+    size_t len;
+    ssize_t n;
+    int rc, rc_finish, regular;
+
+    regular = fstat(fd, &statinfo) == 0 && S_ISREG(statinfo.st_mode);
+    budgie_parser_init(&parser, regular ? (size_t)statinfo.st_size : 0);
+    rc = 0;
+    n = 0;
+
+    if (regular) {
+        for (pos = 0; pos < statinfo.st_size && !rc; pos += len) {
+            len = statinfo.st_size - pos > MAPWIN_SZ ? MAPWIN_SZ : statinfo.st_size - pos;
+            map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, pos);
+            if (map == MAP_FAILED) break;
+            rc = budgie_parser_feed(&parser, map, len);
+            munmap(map, len);
+        }
+        if (pos >= statinfo.st_size || rc) goto finish;
+
+        /* couldn't map the rest of it, so read it instead */
+        if (lseek(fd, pos, SEEK_SET) < 0) {
+            rc = -__LINE__;
+            goto finish;
+        }
+    }
+
+    /* pipes, terminals and whatever else can't be mapped */
+    read_buf = malloc(READBUF_SZ);
+    if (!read_buf) {
         rc = -__LINE__;
-    } else {
-        /* no problemo */
-        rc = 0;
+        goto finish;
+    }
+    while ((n = read(fd, read_buf, READBUF_SZ)) > 0) {
+        rc = budgie_parser_feed(&parser, read_buf, n);
+        if (rc) break;
     }
+    if (n < 0) rc = -__LINE__;
+    free(read_buf);
 
-cleanup:
-    return rc;
+finish:
+    *nbytes = parser.nbytes;
+    rc_finish = budgie_parser_finish(&parser, out, loops);
+    return rc ? rc : rc_finish;
 }
 
-int budgie_oplist_optimize(rd_buf_t **in) {
-    size_t i, n;
-    struct budgie_op *ops;
+/* try to turn the loop at the end of <out>, which starts with the LOPEN at
+ * byte <start> and whose LCLOS hasn't been pushed yet, into a list of
+ * BOPT_D_MULA followed by a BOPT_D_SET 0. this works for loops that don't do
+ * any i/o, don't contain other loops, end up where they started and change
+ * the current cell by exactly 1 each time around, like [->+>++<<].
+ * returns 1 if the loop was replaced. */
+static int budgie_oplist_optimize_mula(rd_buf_t **out, size_t start) {
+    long deltas[256], d;
+    int touched[256];
+    char seen[256];
+    size_t i, ntouched;
+    int j;
+    long pos;
+    struct budgie_op op;
+    unsigned char *ops;
+
+    /* deltas and seen are indexed by cell offset + 128, which keeps them
+     * small. loops that wander further than that are left alone */
+    for (j = 0; j < 256; j++) deltas[j] = seen[j] = 0;
+    ntouched = 0;
+    pos = 0;
+
+    /* simulate a single iteration of the loop */
+    ops = rd_buffer_data(*out);
+    for (i = start + budgie_op_decode(ops + start, &op); i < (*out)->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        switch (op.type) {
+        case BOPT_P_NEXT: pos += op.arg; break;
+        case BOPT_P_PREV: pos -= op.arg; break;
+        case BOPT_D_INCR: d = op.arg; goto adddelta;
+        case BOPT_D_DECR: d = -op.arg; goto adddelta;
+        case BOPT_NOOP: continue;
+        default: return 0;
+        }
+        if (pos < -128 || pos > 127) return 0;
+        continue;
+    adddelta:
+        if (!seen[pos + 128]) {
+            seen[pos + 128] = 1;
+            touched[ntouched++] = pos;
+        }
+        deltas[pos + 128] += d;
+    }
+
+    /* has to be balanced, and has to step the current cell by 1 */
+    if (pos != 0) return 0;
+    if (deltas[128] == -1) d = 1;
+    else if (deltas[128] == 1) d = -1; /* counts up to 0 instead */
+    else return 0;
+
+    /* this is a multiplication (or a copy, or [-]) loop, so replace it */
+    (*out)->len = start;
+    op.off = op.src = 0;
+    for (j = 0; j < (int)ntouched; j++) {
+        pos = touched[j];
+        if (pos == 0 || !deltas[pos + 128]) continue;
 
-    /* initial values */
-    ops = (struct budgie_op *)rd_buffer_data(*in);
-    n = (*in)->len / sizeof(struct budgie_op);
+        op.type = BOPT_D_MULA;
+        op.arg = (int32_t)(deltas[pos + 128] * d);
+        op.off = pos;
+        budgie_op_push(out, &op);
+    }
+
+    /* the loop always leaves the current cell as 0 */
+    op.type = BOPT_D_SET;
+    op.arg = 0;
+    op.off = 0;
+    budgie_op_push(out, &op);
+
+    return 1;
+}
+
+/* try to turn the loop at the end of <out> (same as above) into a
+ * BOPT_P_SCAN, if all it does is move the pointer by a fixed amount, like
+ * [>] or [<<<]. returns 1 if the loop was replaced. */
+static int budgie_oplist_optimize_scan(rd_buf_t **out, size_t start) {
+    size_t i;
+    struct budgie_op op;
+    unsigned char *ops;
+
+    /* the body has to be exactly one pointer move */
+    ops = rd_buffer_data(*out);
+    i = start + budgie_op_decode(ops + start, &op);
+    if (i == (*out)->len) return 0;
+    i += budgie_op_decode(ops + i, &op);
+    if (i != (*out)->len) return 0;
+    if (op.type == BOPT_P_PREV) op.arg = -op.arg;
+    else if (op.type != BOPT_P_NEXT) return 0;
+
+    /* replace it */
+    (*out)->len = start;
+    op.type = BOPT_P_SCAN;
+    budgie_op_push(out, &op);
+
+    return 1;
+}
+
+/* push <d> cells worth of pointer movement to <out>, split up if it doesn't
+ * fit in a single op */
+static void budgie_oplist_flush_move(rd_buf_t **out, long d) {
+    struct budgie_op op;
+
+    op.type = d < 0 ? BOPT_P_PREV : BOPT_P_NEXT;
+    op.off = op.src = 0;
+    if (d < 0) d = -d;
+    while (d > 0) {
+        op.arg = d > BUDGIE_MAX_ARG ? BUDGIE_MAX_ARG : d;
+        budgie_op_push(out, &op);
+        d -= op.arg;
+    }
+}
+
+/* each pass reads the list <in> (with its loops) and writes a new one to <out>,
+ * along with its loops. NOOP's never make it into the new list */
+typedef int (*budgie_oplist_pass)(rd_buf_t *in, const struct budgie_loops *loops, rd_buf_t **out,
+                                  struct budgie_loops *out_loops, struct budgie_stats *stats);
+
+/* replace scan loops, [-], [+] and multiplication loops */
+static int budgie_oplist_optimize_loops(rd_buf_t *in, const struct budgie_loops *loops, rd_buf_t **out,
+                                        struct budgie_loops *out_loops, struct budgie_stats *stats) {
+    size_t i, k, lopen;
+    long loop;
+    struct budgie_op op;
+    unsigned char *ops;
+
+    ops = rd_buffer_data(in);
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        if (op.type == BOPT_NOOP) continue;
+        if (op.type == BOPT_F_LOPEN) {
+            loop = budgie_loops_open(out_loops, (*out)->len);
+            if (loop < 0) return -__LINE__;
+            op.arg = loop;
+        } else if (op.type == BOPT_F_LCLOS) {
+            /* only innermost loops can be replaced, which are the ones that
+             * close before the next loop opens */
+            k = op.arg;
+            if (k + 1 == loops->n || loops->loop[k + 1].open > loops->loop[k].close) {
+                lopen = out_loops->loop[out_loops->cur].open;
+                if (budgie_oplist_optimize_scan(out, lopen)) {
+                    if (stats) stats->loops_scan++;
+                    budgie_loops_drop(out_loops);
+                    continue;
+                }
+                if (budgie_oplist_optimize_mula(out, lopen)) {
+                    /* just a BOPT_D_SET if it only cleared the cell */
+                    budgie_op_decode(rd_buffer_data(*out) + lopen, &op);
+                    if (stats && op.type == BOPT_D_SET) stats->loops_clear++;
+                    else if (stats) stats->loops_mula++;
+                    budgie_loops_drop(out_loops);
+                    continue;
+                }
+            }
+            op.arg = budgie_loops_close(out_loops, (*out)->len);
+        }
+        budgie_op_push(out, &op);
+    }
+
+    return 0;
+}
+
+/* sink pointer movement to the end of each basic block. the data ops in
+ * between get the offset of the cell they work on instead, so `>+>+<<` ends
+ * up as two increments at [+1] and [+2] and no movement at all, and moves
+ * that cancel out (like `><`) disappear. blocks end at loop brackets, since
+ * those test the current cell */
+static int budgie_oplist_optimize_sink(rd_buf_t *in, const struct budgie_loops *loops, rd_buf_t **out,
+                                       struct budgie_loops *out_loops, struct budgie_stats *stats) {
+    size_t i;
+    long d, off, src, loop;
+    struct budgie_op op;
+    unsigned char *ops;
+
+    (void)loops;
+    (void)stats;
+    ops = rd_buffer_data(in);
+    d = 0;
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        switch (op.type) {
+        case BOPT_P_NEXT: d += op.arg; continue;
+        case BOPT_P_PREV: d -= op.arg; continue;
+        case BOPT_NOOP: continue;
+        case BOPT_F_LOPEN:
+        case BOPT_F_LCLOS:
+        case BOPT_P_SCAN:
+            /* the pointer has to be where it's supposed to be by now */
+            budgie_oplist_flush_move(out, d);
+            d = 0;
+            if (op.type != BOPT_P_SCAN) {
+                if (op.type == BOPT_F_LOPEN) loop = budgie_loops_open(out_loops, (*out)->len);
+                else loop = budgie_loops_close(out_loops, (*out)->len);
+                if (loop < 0) return -__LINE__;
+                op.arg = loop;
+            }
+            budgie_op_push(out, &op);
+            continue;
+        default: break;
+        }
+
+        /* data op, so check that the offsets still fit */
+        off = op.off + d;
+        src = op.type == BOPT_D_MULA ? op.src + d : 0;
+        if (off < -BUDGIE_MAX_ARG || off > BUDGIE_MAX_ARG
+                || src < -BUDGIE_MAX_ARG || src > BUDGIE_MAX_ARG) {
+            budgie_oplist_flush_move(out, d);
+            d = 0;
+            off = op.off;
+            src = op.src;
+        }
+
+        op.off = off;
+        op.src = src;
+        budgie_op_push(out, &op);
+    }
+
+    /* movement at the very end doesn't matter anymore */
+    return 0;
+}
+
+/* whether <op> reads or writes the cell <off> away */
+__inline static int budgie_op_touches(const struct budgie_op *op, int32_t off) {
+    switch (op->type) {
+    case BOPT_D_INCR:
+    case BOPT_D_DECR:
+    case BOPT_D_SET:
+    case BOPT_D_OUT:
+    case BOPT_D_IN:     return op->off == off;
+    case BOPT_D_MULA:   return op->off == off || op->src == off;
+    default:            return 0;
+    }
+}
+
+/* try to fold the arithmetic op <op> into one of the last <n> ops of a basic
+ * block in <ops>: the last one before it that touches the same cell, as long
+ * as all that one does is change the cell too. so `+-` cancels out, `++>-<+`
+ * becomes a single +3, `[-]+++` becomes a single set to 3, and anything that
+ * is set right after goes away. returns 1 if <op> was folded into <ops> */
+static int budgie_oplist_fold(struct budgie_op *ops, size_t n, const struct budgie_op *op) {
+    struct budgie_op *prev;
+    long v;
+    size_t j;
+
+    if (op->type != BOPT_D_INCR && op->type != BOPT_D_DECR && op->type != BOPT_D_SET) return 0;
+
+    for (j = n; j > 0 && n - j < BUDGIE_FOLD_WINDOW; j--) {
+        prev = &ops[j - 1];
+        if (!budgie_op_touches(prev, op->off)) continue;
+        if (prev->type != BOPT_D_INCR && prev->type != BOPT_D_DECR && prev->type != BOPT_D_SET) return 0;
+
+        /* whatever it was, it gets overwritten */
+        if (op->type == BOPT_D_SET) {
+            *prev = *op;
+            return 1;
+        }
+
+        v = prev->type == BOPT_D_DECR ? -(long)prev->arg : (long)prev->arg;
+        v += op->type == BOPT_D_DECR ? -(long)op->arg : (long)op->arg;
+        if (v < -BUDGIE_MAX_ARG || v > BUDGIE_MAX_ARG) return 0;
 
-    /* loop through all instructions */
+        if (prev->type == BOPT_D_SET) {
+            prev->arg = v;
+        } else if (v == 0) {
+            prev->type = BOPT_NOOP;
+        } else {
+            prev->type = v < 0 ? BOPT_D_DECR : BOPT_D_INCR;
+            prev->arg = v < 0 ? -v : v;
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/* push the ops of a basic block held in <block> to <out>, leaving <block>
+ * empty */
+static void budgie_oplist_flush_block(rd_buf_t **out, rd_buf_t *block) {
+    struct budgie_op *ops;
+    size_t i, n;
+
+    ops = (struct budgie_op *)rd_buffer_data(block);
+    n = block->len / sizeof(*ops);
     for (i = 0; i < n; i++) {
-        if (ops[i].type == BOPT_F_LCLOS) {
-            if (i >= 2 && (ops[i-1].type == BOPT_D_DECR || ops[i-1].type == BOPT_D_INCR) && ops[i-2].type == BOPT_F_LOPEN) {
-                /* this is [-] or [+] which optimizes to set 0 */
-                ops[i-2].type = BOPT_D_SET;
-                ops[i-2].arg = 0;
-
-                /* the remaining ops can be changed to NOOP's */
-                ops[i-1].type = BOPT_NOOP;
-                ops[i].type = BOPT_NOOP;
+        if (ops[i].type != BOPT_NOOP) budgie_op_push(out, &ops[i]);
+    }
+    block->len = 0;
+}
+
+/* fold arithmetic on the same cell together within each basic block, and drop
+ * loops (and scans) that can never run since the cell is known to be 0 when
+ * they start:
+ * ones right after another loop or a scan, after the cell was set to 0, or
+ * before anything was written at all. the data ops of a block are held
+ * decoded until it ends, so that folding can change them in place */
+static int budgie_oplist_optimize_fold(rd_buf_t *in, const struct budgie_loops *loops, rd_buf_t **out,
+                                       struct budgie_loops *out_loops, struct budgie_stats *stats) {
+    size_t i;
+    long loop;
+    int zero, blank;
+    struct budgie_op op;
+    unsigned char *ops;
+    rd_buf_t *block;
+
+    ops = rd_buffer_data(in);
+    block = rd_buffer_init();
+    zero = 1; /* the current cell is 0 */
+    blank = 1; /* every cell is still 0 */
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        switch (op.type) {
+        case BOPT_NOOP: continue;
+        case BOPT_D_INCR:
+        case BOPT_D_DECR:
+        case BOPT_D_SET:
+        case BOPT_D_MULA:
+        case BOPT_D_IN:
+            /* setting a cell that is already 0 to 0 does nothing */
+            if (op.type == BOPT_D_SET && op.arg == 0 && (blank || (zero && op.off == 0))) {
+                if (stats) stats->ops_folded++;
+                continue;
+            }
+            if (op.off == 0) zero = op.type == BOPT_D_SET && op.arg == 0;
+            blank = 0;
+            /* fall through */
+        case BOPT_D_OUT:
+            if (budgie_oplist_fold((struct budgie_op *)rd_buffer_data(block),
+                                   block->len / sizeof(op), &op)) {
+                if (stats) stats->ops_folded++;
+            } else {
+                rd_buffer_push(&block, (unsigned char *)&op, sizeof(op));
+            }
+            continue;
+        case BOPT_F_LOPEN:
+            if (zero || blank) {
+                /* skip the whole loop, leaving the cell as 0 */
+                i = loops->loop[op.arg].close;
+                i += budgie_op_decode(ops + i, &op);
+                if (stats) stats->loops_dead++;
+                continue;
+            }
+            break;
+        case BOPT_P_SCAN:
+            /* and scans don't move off a 0 */
+            if (zero || blank) {
+                if (stats) stats->loops_dead++;
+                continue;
             }
+            break;
+        default: break;
         }
+
+        /* anything else ends the block */
+        budgie_oplist_flush_block(out, block);
+        if (op.type == BOPT_F_LOPEN || op.type == BOPT_F_LCLOS) {
+            if (op.type == BOPT_F_LOPEN) loop = budgie_loops_open(out_loops, (*out)->len);
+            else loop = budgie_loops_close(out_loops, (*out)->len);
+            if (loop < 0) {
+                rd_buffer_free(block);
+                return -__LINE__;
+            }
+            op.arg = loop;
+        }
+        budgie_op_push(out, &op);
+
+        /* loops only ever end once the cell is 0, and so do scans. the
+         * cell a move goes to is only known if nothing was written yet */
+        if (op.type == BOPT_F_LOPEN) zero = 0;
+        else if (op.type == BOPT_F_LCLOS || op.type == BOPT_P_SCAN) zero = 1;
+        else zero = blank;
+    }
+
+    budgie_oplist_flush_block(out, block);
+    rd_buffer_free(block);
+    return 0;
+}
+
+/* swap in the list (and loops) a pass wrote, or throw them away if it failed */
+static int budgie_oplist_replace(rd_buf_t **in, struct budgie_loops *loops,
+                                 rd_buf_t *out, struct budgie_loops *out_loops, int rc) {
+    if (rc) {
+        rd_buffer_free(out);
+        budgie_loops_free(out_loops);
+        return rc;
+    }
+
+    rd_buffer_free(*in);
+    budgie_loops_free(loops);
+    *in = out;
+    *loops = *out_loops;
+    return 0;
+}
+
+int budgie_oplist_optimize(rd_buf_t **in, struct budgie_loops *loops, struct budgie_stats *stats) {
+    static const budgie_oplist_pass passes[] = {
+        budgie_oplist_optimize_loops, /* loops first, while they are still plain */
+        budgie_oplist_optimize_sink, /* then get rid of moves in straight-line code */
+        budgie_oplist_optimize_fold /* which leaves ops on the same cell to fold */
+    };
+    struct budgie_loops out_loops;
+    rd_buf_t *out;
+    size_t i;
+    int rc;
+
+    for (i = 0; i < sizeof(passes) / sizeof(passes[0]); i++) {
+        /* no pass makes the oplist much longer */
+        out = rd_buffer_initsz((*in)->len + 1);
+        budgie_loops_init(&out_loops);
+        rc = passes[i](*in, loops, &out, &out_loops, stats);
+        rc = budgie_oplist_replace(in, loops, out, &out_loops, rc);
+        if (rc) return rc;
     }
 
     /* ... TODO ... add more kinds of optimizations */
@@ -130,13 +763,17 @@ const char *op2str(enum budgie_op_type type) {
     case BOPT_F_LCLOS: return "BOPT_F_LCLOS";
     case BOPT_NOOP: return "BOPT_NOOP";
     case BOPT_D_SET: return "BOPT_D_SET";
+    case BOPT_D_MULA: return "BOPT_D_MULA";
+    case BOPT_P_SCAN: return "BOPT_P_SCAN";
     default: return NULL;
     }
 }
 
 void test_code(const char *code, size_t len, int expect) {
     rd_buf_t *data = NULL, *output;
-    struct budgie_op *ops;
+    struct budgie_op op;
+    struct budgie_loops loops;
+    struct budgie_loop *loop;
     size_t i, n, j, t = 0;
     int rc;
 
@@ -146,7 +783,7 @@ void test_code(const char *code, size_t len, int expect) {
     rd_buffer_push(&data, (const unsigned char *)code, len);
 
     /* compile the instructions to an IR */
-    rc = budgie_oplist_create(data, &output);
+    rc = budgie_oplist_create(data, &output, &loops);
     if (rc == 0 && expect != 0) {
         printf("expected failure but got success...\n");
         goto cleanup;
@@ -161,30 +798,63 @@ void test_code(const char *code, size_t len, int expect) {
     }
 
     /* optimize the IR */
-    budgie_oplist_optimize(&output);
+    budgie_oplist_optimize(&output, &loops, NULL);
 
     /* loop through all the IR instructions */
-    n = output->len / sizeof(struct budgie_op);
-    ops = (struct budgie_op *)rd_buffer_data(output);
-    for (i = 0; i < n; i++) {
-        if (ops[i].type == BOPT_F_LCLOS) t--;
+    for (i = n = 0; i < output->len; n++) {
+        i += budgie_op_decode(rd_buffer_data(output) + i, &op);
+        if (op.type == BOPT_F_LCLOS) t--;
         for (j = 0; j < t; j++) {
             printf("\t");
         }
-        printf("%lu = %s %u\n", i, op2str(ops[i].type), ops[i].arg);
-        if (ops[i].type == BOPT_F_LOPEN) t++;
+        printf("%lu = %s %d %d %d\n", n, op2str(op.type), op.arg, op.off, op.src);
+        if (op.type == BOPT_F_LOPEN) t++;
+    }
+    printf("%lu ops in %lu bytes\n", n, output->len);
+
+    /* check that the loop table points at the right brackets */
+    for (i = 0; i < loops.n; i++) {
+        loop = &loops.loop[i];
+        budgie_op_decode(rd_buffer_data(output) + loop->open, &op);
+        if (op.type != BOPT_F_LOPEN || op.arg != (int32_t)i) printf("warning: loop %lu opens wrong\n", i);
+        budgie_op_decode(rd_buffer_data(output) + loop->close, &op);
+        if (op.type != BOPT_F_LCLOS || op.arg != (int32_t)i) printf("warning: loop %lu closes wrong\n", i);
+        if (loop->parent != BUDGIE_NO_LOOP && (loop->parent >= i
+                || loops.loop[loop->parent].close < loop->close)) {
+            printf("warning: loop %lu isn't in its parent\n", i);
+        }
     }
+    printf("%lu loops\n", loops.n);
 
 cleanup:
     /* free memory */
     rd_buffer_free(data);
     rd_buffer_free(output);
+    budgie_loops_free(&loops);
+}
+
+void test_encoding(int32_t v) {
+    struct budgie_op op, dec;
+    unsigned char enc[BUDGIE_MAX_OP_SZ];
+    size_t n;
+
+    op.type = BOPT_D_MULA;
+    op.arg = op.off = op.src = v;
+    n = budgie_op_encode(&op, enc);
+    if (budgie_op_decode(enc, &dec) != n || dec.type != op.type
+            || dec.arg != v || dec.off != v || dec.src != v) {
+        printf("warning: %d doesn't survive encoding and decoding\n", v);
+    }
 }
 
 int main() {
     /* example brainfuck code */
     const char code[] = "say hello world! +[-[<<[+[--->]-[<<<]]]>>>-]>-.---.>..>.<<<<-.<+.>>>>>.>.<<.<-.ok goodbye";
-    const char optim_code[] = "++++[-]++";
+    const char optim_code[] = "++++[-]++[->+>+++<<]>[-<<->>]>+>+>+<<<.[>][<<<<]>>[>>[<]]";
+    const int32_t values[] = { 0, 1, -1, 63, -64, 64, 127, -128, 255, 8191, 8192,
+        65535, -65536, 0x7FFFFFFF, -0x7FFFFFFF - 1 };
+    char long_code[1024];
+    size_t i;
 
     /* example bad code */
     const char bad_code1[] = "[[ oops no good";
@@ -196,9 +866,14 @@ int main() {
     test_code(bad_code1, sizeof(bad_code1), 1);
     test_code(bad_code2, sizeof(bad_code2), 1);
 
-    if (sizeof(struct budgie_op) != 2) {
-        printf("warning: expecting sizeof(struct budgie_op) = 2, but it is %ld instead. memory usage may be increased.\n",
-            sizeof(struct budgie_op));
+    /* long runs don't get split */
+    for (i = 0; i < sizeof(long_code) - 2; i++) long_code[i] = i < 600 ? '+' : '>';
+    long_code[i++] = '.';
+    long_code[i] = '\0';
+    test_code(long_code, sizeof(long_code), 0);
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        test_encoding(values[i]);
     }
 
     return 0;
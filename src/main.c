@@ -1,83 +1,335 @@
 #define _POSIX_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <rudolph/buffer.h>
 #include <rudolph/elf.h>
 #include <rudolph/elf_link.h>
+#include "backend.h"
+#include "batch.h"
+#include "cache.h"
+#include "compile.h"
 #include "ir.h"
+#include "options.h"
+#include "interp.h"
+#include "peval.h"
+#include "profile.h"
+#include "stats.h"
 
-#define READBUF_SZ  65536
+int main(int argc, char **argv) {
+    int rc, i, in_fd, stats_json, run, interp, optimize, batch, nnames, ngrams;
+    const char *out_name, *in_name, *val, *profile_name, *cache_dir;
+    char *end, *default_dir;
+    struct budgie_options opts;
+    struct budgie_stats stats;
+    struct budgie_program prog;
+    struct budgie_compile_options copts;
+    struct budgie_batch_options bopts;
+    struct budgie_cache cache;
+    const struct budgie_backend *backend;
+    size_t peval_steps, cache_size;
 
-extern int budgie_translate_x86_64_linux(rd_buf_t *in, rd_buf_t **out);
+    /* default options */
+    out_name = NULL;
+    in_name = NULL;
+    opts.io_buffer = BIOB_FULL;
+    opts.eof = BEOF_UNCHANGED;
+    opts.stats = NULL;
+    opts.start = NULL;
+    opts.tape = BTAPE_STATIC;
+    opts.tape_size = 0; /* depends on the tape */
+    opts.cell_size = 1;
+    opts.instrument = NULL;
+    opts.profile = NULL;
+    opts.align = BALIGN_HOT;
+    opts.align_bytes = BUDGIE_ALIGN_BYTES;
+    profile_name = NULL;
+    peval_steps = BUDGIE_PEVAL_STEPS;
+    stats_json = 0;
+    run = 0;
+    interp = 0;
+    optimize = 1;
+    batch = 0;
+    ngrams = 0;
+    bopts.jobs = 0; /* one per cpu */
+    backend = budgie_backend_default();
+    nnames = 0;
+    cache_dir = NULL;
+    cache_size = BUDGIE_CACHE_SIZE;
+    cache.dir = default_dir = NULL;
+    rc = 0;
 
-int main(int argc, char **argv) {
-    /* todo - better input */
-    rd_buf_t *iput_buf = NULL, *ir = NULL, *final = NULL;
-    int rc;
-    char read_buf[READBUF_SZ];
-    FILE *fp;
-    struct stat statinfo;
-    const char *out_name;
-
-    while (fgets(read_buf, READBUF_SZ, stdin)) {
-        rd_buffer_push(&iput_buf, (unsigned char *)read_buf, strlen(read_buf));
+    /* parse arguments */
+    for (i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--buffer=", 9)) {
+            val = argv[i] + 9;
+            if (!strcmp(val, "none")) opts.io_buffer = BIOB_NONE;
+            else if (!strcmp(val, "line")) opts.io_buffer = BIOB_LINE;
+            else if (!strcmp(val, "full")) opts.io_buffer = BIOB_FULL;
+            else {
+                fprintf(stderr, "Unknown buffering mode `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--eof=", 6)) {
+            val = argv[i] + 6;
+            if (!strcmp(val, "unchanged")) opts.eof = BEOF_UNCHANGED;
+            else if (!strcmp(val, "0")) opts.eof = BEOF_ZERO;
+            else if (!strcmp(val, "-1")) opts.eof = BEOF_MINUS_ONE;
+            else {
+                fprintf(stderr, "Unknown eof behaviour `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--run")) {
+            run = 1;
+        } else if (!strcmp(argv[i], "--interp")) {
+            run = 1;
+            interp = 1;
+        } else if (!strcmp(argv[i], "--batch")) {
+            batch = 1;
+        } else if (!strncmp(argv[i], "--jobs=", 7)) {
+            val = argv[i] + 7;
+            bopts.jobs = strtol(val, &end, 10);
+            if (!*val || *end || bopts.jobs < 1) {
+                fprintf(stderr, "Invalid number of jobs `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--target=", 9)) {
+            val = argv[i] + 9;
+            backend = budgie_backend_find(val);
+            if (!backend) {
+                fprintf(stderr, "Unknown target `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--no-optimize")) {
+            optimize = 0;
+        } else if (!strncmp(argv[i], "--tape=", 7)) {
+            val = argv[i] + 7;
+            if (!strcmp(val, "static")) opts.tape = BTAPE_STATIC;
+            else if (!strcmp(val, "mmap")) opts.tape = BTAPE_MMAP;
+            else {
+                fprintf(stderr, "Unknown tape `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--tape-size=", 12)) {
+            val = argv[i] + 12;
+            opts.tape_size = strtoul(val, &end, 10);
+            if (!*val || *end || *val == '-' || !opts.tape_size || opts.tape_size > BUDGIE_MAX_TAPE_CELLS) {
+                fprintf(stderr, "Invalid tape size `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--cell-size=", 12)) {
+            val = argv[i] + 12;
+            if (!strcmp(val, "8")) opts.cell_size = 1;
+            else if (!strcmp(val, "16")) opts.cell_size = 2;
+            else if (!strcmp(val, "32")) opts.cell_size = 4;
+            else {
+                fprintf(stderr, "Unknown cell size `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--peval=", 8)) {
+            val = argv[i] + 8;
+            peval_steps = strtoul(val, &end, 10);
+            if (!*val || *end || *val == '-') {
+                fprintf(stderr, "Invalid number of steps `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--ngrams=", 9)) {
+            val = argv[i] + 9;
+            ngrams = strtol(val, &end, 10);
+            if (!*val || *end || ngrams < 1 || ngrams > BUDGIE_NGRAM_MAX) {
+                fprintf(stderr, "Invalid n-gram length `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--instrument") || !strncmp(argv[i], "--instrument=", 13)) {
+            opts.instrument = argv[i][12] ? argv[i] + 13 : BUDGIE_PROFILE_NAME;
+        } else if (!strcmp(argv[i], "--profile-use") || !strncmp(argv[i], "--profile-use=", 14)) {
+            profile_name = argv[i][13] ? argv[i] + 14 : BUDGIE_PROFILE_NAME;
+        } else if (!strncmp(argv[i], "--align-loops=", 14)) {
+            val = argv[i] + 14;
+            if (!strcmp(val, "none")) opts.align = BALIGN_NONE;
+            else if (!strcmp(val, "hot")) opts.align = BALIGN_HOT;
+            else if (!strcmp(val, "inner")) opts.align = BALIGN_INNER;
+            else if (!strcmp(val, "all")) opts.align = BALIGN_ALL;
+            else {
+                fprintf(stderr, "Unknown loop alignment policy `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--loop-alignment=", 17)) {
+            val = argv[i] + 17;
+            if (!strcmp(val, "16")) opts.align_bytes = 16;
+            else if (!strcmp(val, "32")) opts.align_bytes = 32;
+            else if (!strcmp(val, "64")) opts.align_bytes = 64;
+            else {
+                fprintf(stderr, "Unknown loop alignment `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--cache") || !strncmp(argv[i], "--cache=", 8)) {
+            cache_dir = argv[i][7] ? argv[i] + 8 : "";
+        } else if (!strncmp(argv[i], "--cache-size=", 13)) {
+            val = argv[i] + 13;
+            cache_size = strtoul(val, &end, 10);
+            if (*end == 'k' || *end == 'K') {
+                cache_size <<= 10;
+                end++;
+            } else if (*end == 'm' || *end == 'M') {
+                cache_size <<= 20;
+                end++;
+            } else if (*end == 'g' || *end == 'G') {
+                cache_size <<= 30;
+                end++;
+            }
+            if (!*val || *end || *val == '-') {
+                fprintf(stderr, "Invalid cache size `%s'!\n", val);
+                return 1;
+            }
+        } else if (!strncmp(argv[i], "--input=", 8)) {
+            in_name = argv[i] + 8;
+        } else if (!strcmp(argv[i], "--stats") || !strncmp(argv[i], "--stats=", 8)) {
+            val = argv[i][7] ? argv[i] + 8 : "text";
+            if (!strcmp(val, "text")) stats_json = 0;
+            else if (!strcmp(val, "json")) stats_json = 1;
+            else {
+                fprintf(stderr, "Unknown stats format `%s'!\n", val);
+                return 1;
+            }
+            opts.stats = &stats;
+        } else if (!strncmp(argv[i], "--", 2)) {
+            fprintf(stderr, "Unknown option `%s'!\n", argv[i]);
+            return 1;
+        } else {
+            /* keep every file given at the front of argv, for --batch */
+            out_name = argv[i];
+            argv[++nnames] = argv[i];
+        }
     }
 
-    /* "compile" the code to an IR */
-    rc = budgie_oplist_create(iput_buf, &ir);
-    if (rc != 0) {
-        fprintf(stderr, "Syntax error in input!\n");
-        goto cleanup;
+    /* when running the program (or just counting its ops), there's no output
+     * file, and stdin is the program's input, so the file to compile is given
+     * instead */
+    if ((run || ngrams) && out_name) {
+        if (in_name) {
+            fprintf(stderr, "Ignoring --input and using `%s'\n", out_name);
+        }
+        in_name = out_name;
+        out_name = NULL;
+    }
+
+    /* compiled code can only run on the machine it was compiled for */
+    if (run && !interp && !backend->run) {
+        fprintf(stderr, "Can't run code for %s here, try --interp!\n", backend->name);
+        return 1;
     }
 
-    /* optimize */
-    budgie_oplist_optimize(&ir);
+    /* only compiled code can count its loops, and only some backends know
+     * how */
+    if (opts.instrument || profile_name) {
+        if (interp || !backend->profile) {
+            fprintf(stderr, "--instrument and --profile-use don't work with --interp or for %s!\n",
+                    backend->name);
+            return 1;
+        }
+    }
 
-    /* temporary - force x86_64_linux */
-    rc = budgie_translate_x86_64_linux(ir, &final);
+    if (!opts.tape_size) opts.tape_size = opts.tape == BTAPE_MMAP ? BUDGIE_MMAP_CELLS : BUDGIE_TAPE_CELLS;
 
-    if (rc) {
-        fprintf(stderr, "Error %d occurred :(\n", rc);
-        goto cleanup;
+    /* only executables get kept, and a cache that can't be used just means
+     * compiling everything again */
+    if (cache_dir && !run && !ngrams) {
+        if (!*cache_dir) cache_dir = default_dir = budgie_cache_default_dir();
+        if (!cache_dir || budgie_cache_open(&cache, cache_dir, cache_size)) {
+            fprintf(stderr, "Can't use cache `%s', ignoring it\n", cache_dir ? cache_dir : "");
+        }
     }
 
-    /* write output file */
-    if (isatty(fileno(stdout))) {
-        /* open the file to write output to */
-        out_name = argc == 2 ? argv[1] : "a.out";
-        fp = fopen(out_name, "wb");
-        if (!fp) {
-            fprintf(stderr, "Error writing output!\n");
+    copts.opts = &opts;
+    copts.backend = backend;
+    copts.optimize = optimize;
+    copts.peval_steps = peval_steps;
+    copts.profile = profile_name;
+    copts.cache = cache.dir ? &cache : NULL;
+
+    /* compile every file given to an executable of its own */
+    if (batch) {
+        if (run || opts.stats || in_name || ngrams || opts.instrument || profile_name) {
+            fprintf(stderr, "--batch can't be used with --run, --interp, --stats, --ngrams, --input, "
+                            "--instrument or --profile-use!\n");
+            rc = 1;
             goto cleanup;
         }
+        if (!nnames) {
+            fprintf(stderr, "--batch needs the files to compile!\n");
+            rc = 1;
+            goto cleanup;
+        }
+        if (!bopts.jobs) bopts.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+        bopts.compile = &copts;
+        rc = budgie_batch_compile(argv + 1, nnames, &bopts) ? 1 : 0;
+        goto cleanup;
+    }
 
-        /* write file */
-        fwrite(rd_buffer_data(final), final->len, sizeof(unsigned char), fp);
+    if (opts.stats) budgie_stats_init(opts.stats);
 
-        /* make output executable */
-        stat(out_name, &statinfo);
-        statinfo.st_mode |= S_IXUSR | S_IXGRP | S_IXOTH;
-        chmod(out_name, statinfo.st_mode);
+    /* read the program from the file given, or stdin */
+    if (in_name && strcmp(in_name, "-")) {
+        in_fd = open(in_name, O_RDONLY);
+        if (in_fd < 0) {
+            fprintf(stderr, "Error reading input `%s'!\n", in_name);
+            rc = 1;
+            goto cleanup;
+        }
+    } else {
+        in_fd = fileno(stdin);
+    }
 
-        fclose(fp);
+    if (ngrams) {
+        /* print which runs of ops the program ended up with, instead of
+         * compiling it */
+        rc = budgie_compile_ir(in_fd, &copts, NULL, &prog);
+        if (!rc) {
+            rc = budgie_stats_ngrams(prog.ir, ngrams, stdout);
+            if (rc) fprintf(stderr, "Error %d occurred :(\n", rc);
+        }
+        budgie_program_free(&prog);
+    } else if (run) {
+        /* compile it and run it right here, or just interpret it */
+        rc = budgie_compile_ir(in_fd, &copts, NULL, &prog);
+        if (!rc) {
+            if (interp) rc = budgie_interp_run(prog.ir, &prog.opts);
+            else rc = backend->run(prog.ir, &prog.opts);
+            if (rc) fprintf(stderr, "Error %d occurred :(\n", rc);
+        }
+        if (!rc && opts.stats) {
+            budgie_stats_phase(opts.stats, BSP_RUN);
+            budgie_stats_print(opts.stats, stats_json, stderr);
+        }
+        budgie_program_free(&prog);
     } else {
-        /* write to stdout */
-        if (argc == 2)
-            fprintf(stderr, "Ignoring output file given and printing to stdout\n");
+        /* write the executable to the file given (or a.out), unless stdout
+         * is piped */
+        if (isatty(fileno(stdout))) {
+            if (!out_name) out_name = "a.out";
+        } else {
+            if (out_name) fprintf(stderr, "Ignoring output file given and printing to stdout\n");
+            out_name = NULL;
+        }
+        rc = budgie_compile(in_fd, out_name, &copts, NULL);
+        if (!rc && opts.stats) budgie_stats_print(opts.stats, stats_json, stderr);
 
-        fwrite(rd_buffer_data(final), final->len, sizeof(unsigned char), stdout);
+        /* make room for what just got put in the cache */
+        if (copts.cache && budgie_cache_evict(copts.cache)) {
+            fprintf(stderr, "Couldn't make room in the cache\n");
+        }
     }
 
-    /* no errors */
-    rc = 0;
+    if (in_fd != fileno(stdin)) close(in_fd);
 
 cleanup:
-    rd_buffer_free(iput_buf);
-    rd_buffer_free(ir);
-    rd_buffer_free(final);
+    budgie_cache_close(&cache);
+    free(default_dir);
 
     return rc;
 }
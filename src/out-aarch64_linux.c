@@ -0,0 +1,729 @@
+/* this file generates aarch64 code for linux from the same oplist as the
+ * x86_64 backend. it keeps things simpler than that one does: the current cell
+ * isn't cached in a register, and loops always jump with instructions that can
+ * reach anywhere in the code */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <rudolph/buffer.h>
+#include <rudolph/elf.h>
+#include <rudolph/elf_link.h>
+#include "ir.h"
+#include "options.h"
+#include "peval.h"
+#include "stats.h"
+#include "aarch64_linux.h"
+
+#define BUDGIE_OUTBUF_SZ 65536
+#define BUDGIE_INBUF_SZ 65536
+#define BUDGIE_PAGE_SZ 65536 /* the largest page size linux uses on aarch64,
+                              * so the guard pages line up with any of them */
+#define BUDGIE_BRANCH_MAX 0x8000000 /* how far b and bl can go either way */
+
+/* registers the generated code keeps things in. x0-x8 are for syscalls and
+ * x9-x15 are scratch */
+#define R_CELL 19 /* address of the current cell */
+#define R_OUT 20 /* start of the output buffer */
+#define R_OUTN 21 /* number of bytes in the output buffer */
+#define R_IN 22 /* start of the input buffer */
+#define R_INPOS 23 /* next unread byte in the input buffer */
+#define R_INEND 24 /* end of what was read into the input buffer */
+#define R_ZR 31 /* xzr or wzr, for most instructions */
+
+/* condition codes for b.cond */
+#define COND_EQ 0x0
+#define COND_LO 0x3
+#define COND_LE 0xD
+
+/* everything about the program being translated that the code generated for
+ * one op depends on */
+struct budgie_aarch64_state {
+    enum budgie_io_buffer io_buffer;
+    enum budgie_eof eof;
+    int out_buffered; /* 1 if `.` appends to the output buffer */
+    size_t flush_pos; /* offset of the output flush routine in the code */
+    size_t write_pos; /* offset of the routine that writes x2 bytes from x1 */
+    size_t getc_pos; /* offset of the input refill routine in the code */
+    size_t *loop_pos; /* offset of the branch in each open loop's lopen */
+    unsigned size; /* log2 of the bytes per cell, as loads and stores want it */
+    int cell_sz; /* bytes per cell (1, 2 or 4) */
+    uint32_t cell_mask; /* the bits of a cell */
+};
+
+__inline static void budgie_aarch64_insn(rd_buf_t **buf, uint32_t insn) {
+    unsigned char bytes[4];
+
+    bytes[0] = insn;
+    bytes[1] = insn >> 8;
+    bytes[2] = insn >> 16;
+    bytes[3] = insn >> 24;
+    rd_buffer_push(buf, bytes, 4);
+}
+
+/* b or bl (given by <op>) from <pos> to <target> */
+__inline static uint32_t budgie_aarch64_b(uint32_t op, size_t pos, size_t target) {
+    return op | ((uint32_t)(((int64_t)target - (int64_t)pos) / 4) & 0x3FFFFFF);
+}
+
+/* a conditional branch (b.cond, cbz, cbnz or tbnz, given by <op>) <by> bytes
+ * forwards or back */
+__inline static uint32_t budgie_aarch64_bcond(uint32_t op, int64_t by) {
+    /* tbz and tbnz only have 14 bits for it, the others 19 */
+    if ((op & 0x7E000000) == 0x36000000) return op | ((uint32_t)(by / 4) & 0x3FFF) << 5;
+    return op | ((uint32_t)(by / 4) & 0x7FFFF) << 5;
+}
+
+/* point the branch at <pos>, emitted with no target yet, to <target> */
+static void budgie_aarch64_patch(rd_buf_t *buf, size_t pos, size_t target) {
+    unsigned char *p;
+    uint32_t insn;
+
+    p = rd_buffer_data(buf) + pos;
+    insn = p[0] | p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    if ((insn & 0x7C000000) == 0x14000000) insn = budgie_aarch64_b(insn, pos, target);
+    else insn = budgie_aarch64_bcond(insn, (int64_t)target - (int64_t)pos);
+    p[0] = insn;
+    p[1] = insn >> 8;
+    p[2] = insn >> 16;
+    p[3] = insn >> 24;
+}
+
+/* mov <rd>, <v>: a movz (or movn, if that takes fewer instructions) of one 16
+ * bit chunk, then a movk for each other chunk that isn't the same as after
+ * that. <sf> picks x (1) or w (0) */
+static void budgie_aarch64_mov(rd_buf_t **buf, int sf, unsigned rd, uint64_t v) {
+    unsigned i, chunks, nz, nn, inv, first;
+    uint32_t chunk, op;
+
+    chunks = sf ? 4 : 2;
+    if (!sf) v &= 0xFFFFFFFF;
+    for (i = nz = nn = 0; i < chunks; i++) {
+        chunk = (v >> (16 * i)) & 0xFFFF;
+        if (chunk) nz++;
+        if (chunk != 0xFFFF) nn++;
+    }
+
+    inv = nn < nz;
+    first = 1;
+    for (i = 0; i < chunks; i++) {
+        chunk = (v >> (16 * i)) & 0xFFFF;
+        if (chunk == (inv ? 0xFFFF : 0)) continue;
+        if (first) op = inv ? 0x12800000 : 0x52800000; /* movn or movz */
+        else op = 0x72800000; /* movk */
+        if (first && inv) chunk = ~chunk & 0xFFFF;
+        budgie_aarch64_insn(buf, op | (uint32_t)sf << 31 | i << 21 | chunk << 5 | rd);
+        first = 0;
+    }
+    /* 0 or all ones */
+    if (first) budgie_aarch64_insn(buf, (inv ? 0x12800000 : 0x52800000) | (uint32_t)sf << 31 | rd);
+}
+
+/* mov <rd>, <rm> (as orr <rd>, xzr, <rm>) */
+__inline static void budgie_aarch64_movr(rd_buf_t **buf, unsigned rd, unsigned rm) {
+    budgie_aarch64_insn(buf, 0xAA0003E0 | rm << 16 | rd);
+}
+
+/* add <rd>, <rn>, <v> (or sub for a negative <v>), with x9 as scratch if <v>
+ * doesn't fit in immediates */
+static void budgie_aarch64_addi(rd_buf_t **buf, int sf, unsigned rd, unsigned rn, int64_t v) {
+    uint32_t op;
+    uint64_t a;
+
+    op = (v < 0 ? 0x51000000 : 0x11000000) | (uint32_t)sf << 31;
+    a = v < 0 ? -(uint64_t)v : (uint64_t)v;
+    if (a == 0) {
+        if (rd != rn) budgie_aarch64_movr(buf, rd, rn);
+    } else if (a < 0x1000000) {
+        /* up to 12 bits at a time, the top ones shifted left by 12 */
+        if (a >> 12) {
+            budgie_aarch64_insn(buf, op | 1 << 22 | (uint32_t)(a >> 12) << 10 | rn << 5 | rd);
+            rn = rd;
+        }
+        if (a & 0xFFF) budgie_aarch64_insn(buf, op | (uint32_t)(a & 0xFFF) << 10 | rn << 5 | rd);
+    } else {
+        budgie_aarch64_mov(buf, sf, 9, v);
+        budgie_aarch64_insn(buf, 0x0B000000 | (uint32_t)sf << 31 | 9 << 16 | rn << 5 | rd);
+    }
+}
+
+/* a load (ldr, ldrh or ldrb, by <size>) into <rt> from <off> bytes away from
+ * <rn>, or with <load> 0, a store. the offset goes in the instruction if it
+ * fits, and in x9 if not */
+static void budgie_aarch64_mem(rd_buf_t **buf, int load, unsigned size, unsigned rt, unsigned rn,
+                               int64_t off) {
+    int64_t scale;
+
+    scale = (int64_t)1 << size;
+    if (off >= 0 && off % scale == 0 && off / scale < 4096) {
+        /* ldr <rt>, [<rn>, #<off>] */
+        budgie_aarch64_insn(buf, (load ? 0x39400000 : 0x39000000) | size << 30
+                                 | (uint32_t)(off / scale) << 10 | rn << 5 | rt);
+    } else if (off >= -256 && off < 256) {
+        /* ldur <rt>, [<rn>, #<off>] */
+        budgie_aarch64_insn(buf, (load ? 0x38400000 : 0x38000000) | size << 30
+                                 | ((uint32_t)off & 0x1FF) << 12 | rn << 5 | rt);
+    } else {
+        /* mov x9, <off>
+         * ldr <rt>, [<rn>, x9] */
+        budgie_aarch64_mov(buf, 1, 9, off);
+        budgie_aarch64_insn(buf, (load ? 0x38606800 : 0x38206800) | size << 30 | 9 << 16 | rn << 5 | rt);
+    }
+}
+
+/* load the cell <off> away into <rt>, or store <rt> to it */
+__inline static void budgie_aarch64_cell(struct budgie_aarch64_state *st, rd_buf_t **buf, int load,
+                                         unsigned rt, int32_t off) {
+    budgie_aarch64_mem(buf, load, st->size, rt, R_CELL, (int64_t)off * st->cell_sz);
+}
+
+/* ldr <rd>, <address in bss or data> ; relocated into the literal right
+ * after it
+ *  ldr <rd>, .+8
+ *  b .+12
+ *  .quad 0
+ */
+static void budgie_aarch64_addr(rd_buf_t **buf, unsigned rd, struct rd_elf_link_relocation *reloc,
+                                enum rd_elf_link_reloc_type type, size_t src) {
+    /* keep the literal 8 byte aligned */
+    if ((*buf)->len % 8) budgie_aarch64_insn(buf, 0xD503201F);
+    budgie_aarch64_insn(buf, 0x58000040 | rd);
+    budgie_aarch64_insn(buf, 0x14000003);
+    reloc->type = type;
+    reloc->target = (*buf)->len;
+    reloc->src = src;
+    rd_buffer_push(buf, (const unsigned char *)"\0\0\0\0\0\0\0\0", 8);
+}
+
+__inline static void budgie_aarch64_syscall(rd_buf_t **buf, unsigned nr) {
+    /* mov x8, <nr>
+     * svc #0 */
+    budgie_aarch64_mov(buf, 1, 8, nr);
+    budgie_aarch64_insn(buf, 0xD4000001);
+}
+
+static void budgie_aarch64_rt_flush(struct budgie_aarch64_state *st, rd_buf_t **buf) {
+    size_t empty_pos, err_pos, loop_pos;
+
+    /* flush:
+     *  mov x1, x20 ; write out the output buffer
+     *  mov x2, x21
+     *  mov x21, #0 ; which is empty again after
+     * write: ; (write x2 bytes from x1)
+     *  cbz x2, .done
+     * .loop:
+     *  mov x0, #1 ; stdout
+     *  mov x8, #64 ; (64 = write)
+     *  svc #0
+     *  cmp x0, #0 ; on error, just drop whatever is left
+     *  b.le .done
+     *  add x1, x1, x0 ; short writes continue where they left off
+     *  sub x2, x2, x0
+     *  cbnz x2, .loop
+     * .done:
+     *  ret
+     */
+    st->flush_pos = (*buf)->len;
+    budgie_aarch64_movr(buf, 1, R_OUT);
+    budgie_aarch64_movr(buf, 2, R_OUTN);
+    budgie_aarch64_mov(buf, 1, R_OUTN, 0);
+    st->write_pos = empty_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0xB4000002);
+    loop_pos = (*buf)->len;
+    budgie_aarch64_mov(buf, 1, 0, 1);
+    budgie_aarch64_syscall(buf, 64);
+    budgie_aarch64_insn(buf, 0xF100001F);
+    err_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0x54000000 | COND_LE);
+    budgie_aarch64_insn(buf, 0x8B000021);
+    budgie_aarch64_insn(buf, 0xCB000042);
+    budgie_aarch64_insn(buf, budgie_aarch64_bcond(0xB5000002, (int64_t)loop_pos - (int64_t)(*buf)->len));
+    budgie_aarch64_patch(*buf, empty_pos, (*buf)->len);
+    budgie_aarch64_patch(*buf, err_pos, (*buf)->len);
+    budgie_aarch64_insn(buf, 0xD65F03C0);
+}
+
+static void budgie_aarch64_rt_getc(struct budgie_aarch64_state *st, rd_buf_t **buf) {
+    size_t eof_pos;
+
+    /* the input buffer lives in bss too; x23 points to the next unread byte
+     * and x24 to the end of what was read, so it is empty when x23 == x24.
+     * this routine is only called when the buffer is empty, and returns the
+     * next byte in w0 after refilling the buffer, or at eof, what `,` stores
+     * then (-1 with BEOF_UNCHANGED, which the caller checks for)
+     *
+     * getc:
+     *  mov x15, x30 ; (only with buffered output) bl overwrites the return address
+     *  bl flush ; we're about to block, so anything written so far has to be visible
+     *  mov x30, x15
+     *  mov x0, #0 ; stdin
+     *  mov x1, x22
+     *  mov x2, <size of the input buffer>
+     *  mov x8, #63 ; (63 = read)
+     *  svc #0
+     *  cmp x0, #0 ; nothing read (or an error) is treated as eof
+     *  b.le .eof
+     *  mov x23, x22 ; the buffer starts at the beginning again
+     *  add x24, x22, x0 ; end of what was read
+     *  ldrb w0, [x23], #1 ; hand out the first byte
+     *  ret
+     * .eof: ; the buffer is left empty, so the next `,` tries again
+     *  mov w0, <0 or -1>
+     *  ret
+     */
+    st->getc_pos = (*buf)->len;
+    if (st->out_buffered) {
+        budgie_aarch64_movr(buf, 15, 30);
+        budgie_aarch64_insn(buf, budgie_aarch64_b(0x94000000, (*buf)->len, st->flush_pos));
+        budgie_aarch64_movr(buf, 30, 15);
+    }
+    budgie_aarch64_mov(buf, 1, 0, 0);
+    budgie_aarch64_movr(buf, 1, R_IN);
+    /* without buffering, only ever ask for a single byte so that nothing
+     * past what the program reads gets taken from stdin */
+    budgie_aarch64_mov(buf, 1, 2, st->io_buffer == BIOB_NONE ? 1 : BUDGIE_INBUF_SZ);
+    budgie_aarch64_syscall(buf, 63);
+    budgie_aarch64_insn(buf, 0xF100001F);
+    eof_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0x54000000 | COND_LE);
+    budgie_aarch64_movr(buf, R_INPOS, R_IN);
+    budgie_aarch64_insn(buf, 0x8B000000 | R_IN << 5 | R_INEND);
+    budgie_aarch64_insn(buf, 0x38401400 | R_INPOS << 5);
+    budgie_aarch64_insn(buf, 0xD65F03C0);
+    budgie_aarch64_patch(*buf, eof_pos, (*buf)->len);
+    budgie_aarch64_mov(buf, 0, 0, st->eof == BEOF_ZERO ? 0 : 0xFFFFFFFF);
+    budgie_aarch64_insn(buf, 0xD65F03C0);
+}
+
+__inline static size_t budgie_aarch64_abs(int32_t x) {
+    return x < 0 ? -(size_t)x : (size_t)x;
+}
+
+/* round <n> up to a whole number of pages */
+__inline static size_t budgie_aarch64_pages(size_t n) {
+    return (n + BUDGIE_PAGE_SZ - 1) / BUDGIE_PAGE_SZ * BUDGIE_PAGE_SZ;
+}
+
+/* map a tape of <len> bytes with <guard> bytes of inaccessible pages on
+ * either side, the same way the x86_64 backend does, and leave the address of
+ * its first byte in x19. if the tape can't be mapped, the program exits with
+ * code 1 */
+static void budgie_aarch64_tape_map(rd_buf_t **buf, size_t len, size_t guard) {
+    size_t map_pos, prot_pos;
+
+    /* mmap(NULL, <length>, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+     *  mov x0, #0
+     *  mov x1, <length>
+     *  mov x2, #0
+     *  mov x3, #0x4022
+     *  mov x4, #-1
+     *  mov x5, #0
+     *  mov x8, #222 ; (222 = mmap)
+     *  svc #0
+     *  tbnz x0, #63, .fail ; errors are negative
+     */
+    budgie_aarch64_mov(buf, 1, 0, 0);
+    budgie_aarch64_mov(buf, 1, 1, 2 * guard + budgie_aarch64_pages(len));
+    budgie_aarch64_mov(buf, 1, 2, 0);
+    budgie_aarch64_mov(buf, 1, 3, 0x4022);
+    budgie_aarch64_mov(buf, 1, 4, (uint64_t)-1);
+    budgie_aarch64_mov(buf, 1, 5, 0);
+    budgie_aarch64_syscall(buf, 222);
+    map_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0xB7F80000);
+
+    /* then make the tape itself accessible
+     * mprotect(<mapping> + <guard>, <tape length>, PROT_READ | PROT_WRITE)
+     *  add x0, x0, <guard>
+     *  mov x19, x0
+     *  mov x1, <tape length>
+     *  mov x2, #3
+     *  mov x8, #226 ; (226 = mprotect)
+     *  svc #0
+     *  cbnz x0, .fail
+     *  b .ok
+     * .fail:
+     *  mov x0, #1
+     *  mov x8, #93 ; (93 = exit)
+     *  svc #0
+     * .ok:
+     */
+    budgie_aarch64_addi(buf, 1, 0, 0, guard);
+    budgie_aarch64_movr(buf, R_CELL, 0);
+    budgie_aarch64_mov(buf, 1, 1, budgie_aarch64_pages(len));
+    budgie_aarch64_mov(buf, 1, 2, 3);
+    budgie_aarch64_syscall(buf, 226);
+    prot_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0xB5000000);
+    budgie_aarch64_insn(buf, 0x14000004); /* over the three instructions below */
+    budgie_aarch64_patch(*buf, map_pos, (*buf)->len);
+    budgie_aarch64_patch(*buf, prot_pos, (*buf)->len);
+    budgie_aarch64_mov(buf, 1, 0, 1);
+    budgie_aarch64_syscall(buf, 93);
+}
+
+__inline static void budgie_aarch64_op_move(struct budgie_aarch64_state *st, rd_buf_t **buf, int64_t by) {
+    /* add x19, x19, <bytes> (or sub) */
+    budgie_aarch64_addi(buf, 1, R_CELL, R_CELL, by * st->cell_sz);
+}
+
+__inline static void budgie_aarch64_op_incr(struct budgie_aarch64_state *st, rd_buf_t **buf, uint32_t arg,
+                                            int32_t off) {
+    uint32_t imm;
+
+    /* cells wrap around, so only the bits of a cell count, and the store
+     * drops whatever carried out of them
+     *  ldr w10, <cell>
+     *  add w10, w10, <number> ; (or sub, or through w11 if it doesn't fit)
+     *  str w10, <cell>
+     */
+    imm = arg & st->cell_mask;
+    if (imm == 0) return;
+    budgie_aarch64_cell(st, buf, 1, 10, off);
+    if (imm < 0x1000) {
+        budgie_aarch64_insn(buf, 0x11000000 | imm << 10 | 10 << 5 | 10);
+    } else if (((0 - imm) & st->cell_mask) < 0x1000) {
+        budgie_aarch64_insn(buf, 0x51000000 | ((0 - imm) & st->cell_mask) << 10 | 10 << 5 | 10);
+    } else {
+        budgie_aarch64_mov(buf, 0, 11, imm);
+        budgie_aarch64_insn(buf, 0x0B000000 | 11 << 16 | 10 << 5 | 10);
+    }
+    budgie_aarch64_cell(st, buf, 0, 10, off);
+}
+
+__inline static void budgie_aarch64_op_set(struct budgie_aarch64_state *st, rd_buf_t **buf, uint32_t arg,
+                                           int32_t off) {
+    /* mov w10, <number>
+     * str w10, <cell> ; (or just str wzr for 0)
+     */
+    arg &= st->cell_mask;
+    if (arg) budgie_aarch64_mov(buf, 0, 10, arg);
+    budgie_aarch64_cell(st, buf, 0, arg ? 10 : R_ZR, off);
+}
+
+__inline static void budgie_aarch64_op_mula(struct budgie_aarch64_state *st, rd_buf_t **buf, uint32_t arg,
+                                            int32_t off, int32_t src) {
+    uint32_t factor;
+
+    /* ldr w12, <source cell>
+     * ldr w10, <cell>
+     * mov w11, <factor>
+     * madd w10, w12, w11, w10 ; (or just add or sub for 1 and -1)
+     * str w10, <cell>
+     */
+    factor = arg & st->cell_mask;
+    if (factor == 0) return;
+    budgie_aarch64_cell(st, buf, 1, 12, src);
+    budgie_aarch64_cell(st, buf, 1, 10, off);
+    if (factor == 1) {
+        budgie_aarch64_insn(buf, 0x0B000000 | 12 << 16 | 10 << 5 | 10);
+    } else if (factor == st->cell_mask) {
+        budgie_aarch64_insn(buf, 0x4B000000 | 12 << 16 | 10 << 5 | 10);
+    } else {
+        budgie_aarch64_mov(buf, 0, 11, factor);
+        budgie_aarch64_insn(buf, 0x1B000000 | 11 << 16 | 10 << 10 | 12 << 5 | 10);
+    }
+    budgie_aarch64_cell(st, buf, 0, 10, off);
+}
+
+__inline static void budgie_aarch64_op_out(struct budgie_aarch64_state *st, rd_buf_t **buf, int32_t off) {
+    if (!st->out_buffered) {
+        /* add x1, x19, <offset> ; the lowest byte of the cell, since it's
+         *                       ; little-endian
+         * mov x0, #1 ; stdout
+         * mov x2, #1 ; 1 byte
+         * mov x8, #64 ; (64 = write)
+         * svc #0
+         */
+        budgie_aarch64_addi(buf, 1, 1, R_CELL, (int64_t)off * st->cell_sz);
+        budgie_aarch64_mov(buf, 1, 0, 1);
+        budgie_aarch64_mov(buf, 1, 2, 1);
+        budgie_aarch64_syscall(buf, 64);
+        return;
+    }
+
+    /*  ldrb w10, <cell> ; the lowest byte of the cell
+     *  strb w10, [x20, x21] ; append it to the output buffer
+     *  add x21, x21, #1
+     *  cmp w10, #10 ; (only with line buffering) newlines flush right away
+     *  b.eq .flush
+     *  cmp x21, BUDGIE_OUTBUF_SZ ; check if the buffer is full
+     *  b.lo .done
+     * .flush:
+     *  bl flush
+     * .done:
+     */
+    budgie_aarch64_mem(buf, 1, 0, 10, R_CELL, (int64_t)off * st->cell_sz);
+    budgie_aarch64_insn(buf, 0x38206800 | R_OUTN << 16 | R_OUT << 5 | 10);
+    budgie_aarch64_insn(buf, 0x91000400 | R_OUTN << 5 | R_OUTN);
+    if (st->io_buffer == BIOB_LINE) {
+        budgie_aarch64_insn(buf, 0x7100295F);
+        budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x54000000 | COND_EQ, 12));
+    }
+    budgie_aarch64_insn(buf, 0xF140001F | (BUDGIE_OUTBUF_SZ >> 12) << 10 | R_OUTN << 5);
+    budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x54000000 | COND_LO, 8));
+    budgie_aarch64_insn(buf, budgie_aarch64_b(0x94000000, (*buf)->len, st->flush_pos));
+}
+
+__inline static void budgie_aarch64_op_in(struct budgie_aarch64_state *st, rd_buf_t **buf, int32_t off) {
+    size_t eof_pos;
+    int unchanged;
+
+    /*  cmp x23, x24 ; check if the input buffer is empty
+     *  b.lo .fast
+     *  bl getc ; refill it if so
+     *  tbnz w0, #31, .done ; (only with BEOF_UNCHANGED) leave the cell alone at eof
+     *  b .store
+     * .fast:
+     *  ldrb w0, [x23], #1 ; otherwise, just take the next byte out of it
+     * .store:
+     *  str w0, <cell>
+     * .done:
+     */
+    unchanged = st->eof == BEOF_UNCHANGED;
+    eof_pos = 0;
+    budgie_aarch64_insn(buf, 0xEB00001F | R_INEND << 16 | R_INPOS << 5);
+    budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x54000000 | COND_LO, unchanged ? 16 : 12));
+    budgie_aarch64_insn(buf, budgie_aarch64_b(0x94000000, (*buf)->len, st->getc_pos));
+    if (unchanged) {
+        eof_pos = (*buf)->len;
+        budgie_aarch64_insn(buf, 0x37F80000);
+    }
+    budgie_aarch64_insn(buf, 0x14000002);
+    budgie_aarch64_insn(buf, 0x38401400 | R_INPOS << 5);
+    budgie_aarch64_cell(st, buf, 0, 0, off);
+    if (unchanged) budgie_aarch64_patch(*buf, eof_pos, (*buf)->len);
+}
+
+__inline static void budgie_aarch64_op_lopen(struct budgie_aarch64_state *st, rd_buf_t **buf, int32_t arg) {
+    /* ldr w10, [x19]
+     * cbnz w10, .body
+     * b <past the matching lclos> ; (a b reaches further than a cbz)
+     * .body:
+     */
+    budgie_aarch64_cell(st, buf, 1, 10, 0);
+    budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x3500000A, 8));
+    st->loop_pos[arg] = (*buf)->len;
+    budgie_aarch64_insn(buf, 0x14000000);
+}
+
+__inline static void budgie_aarch64_op_lclos(struct budgie_aarch64_state *st, rd_buf_t **buf, int32_t arg) {
+    size_t body;
+    int64_t by;
+
+    /* ldr w10, [x19]
+     * cbnz w10, <the start of the loop's body>
+     * (or cbz w10, .done ; b <start> ; .done: if that's out of range of a cbnz)
+     */
+    body = st->loop_pos[arg] + 4;
+    budgie_aarch64_cell(st, buf, 1, 10, 0);
+    by = (int64_t)body - (int64_t)(*buf)->len;
+    if (by >= -0x100000) {
+        budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x3500000A, by));
+    } else {
+        budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x3400000A, 8));
+        budgie_aarch64_insn(buf, budgie_aarch64_b(0x14000000, (*buf)->len, body));
+    }
+    budgie_aarch64_patch(*buf, st->loop_pos[arg], (*buf)->len);
+}
+
+__inline static void budgie_aarch64_op_scan(struct budgie_aarch64_state *st, rd_buf_t **buf, int32_t arg) {
+    size_t test_pos, loop;
+
+    /*  b .test
+     * .loop:
+     *  add x19, x19, <bytes> ; (or sub)
+     * .test:
+     *  ldr w10, [x19]
+     *  cbnz w10, .loop
+     */
+    test_pos = (*buf)->len;
+    budgie_aarch64_insn(buf, 0x14000000);
+    loop = (*buf)->len;
+    budgie_aarch64_op_move(st, buf, arg);
+    budgie_aarch64_patch(*buf, test_pos, (*buf)->len);
+    budgie_aarch64_cell(st, buf, 1, 10, 0);
+    budgie_aarch64_insn(buf, budgie_aarch64_bcond(0x3500000A, (int64_t)loop - (int64_t)(*buf)->len));
+}
+
+int budgie_translate_aarch64_linux(rd_buf_t *in, const struct budgie_options *opts, rd_buf_t **out) {
+    struct rd_elf_link_relocation relocs[BUDGIE_AARCH64_RELOCS + 1];
+    size_t i, nrelocs, nloops, reach, guard, tape_len, out_len, bss_size, outbuf, jmp_pos, copy_pos;
+    rd_buf_t *code, *data;
+    struct budgie_op op;
+    unsigned char *ops;
+    int rc, use_out, use_in;
+    struct budgie_aarch64_state state, *st;
+
+    /* initialization */
+    st = &state;
+    memset(st, 0, sizeof(*st));
+    st->io_buffer = opts->io_buffer;
+    st->eof = opts->eof;
+    st->cell_sz = opts->cell_size;
+    st->size = st->cell_sz == 4 ? 2 : st->cell_sz == 2 ? 1 : 0;
+    st->cell_mask = st->cell_sz == 4 ? 0xFFFFFFFF : ((uint32_t)1 << (8 * st->cell_sz)) - 1;
+    bss_size = opts->tape == BTAPE_STATIC ? opts->tape_size * st->cell_sz : 0;
+    ops = rd_buffer_data(in);
+    code = data = NULL;
+    rc = 0;
+
+    /* only emit the parts of the runtime that the program actually uses */
+    use_out = use_in = 0;
+    nloops = 0;
+    reach = 0; /* furthest away from a cell on the tape the program can get */
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        if (budgie_aarch64_abs(op.off) > reach) reach = budgie_aarch64_abs(op.off);
+        if (budgie_aarch64_abs(op.src) > reach) reach = budgie_aarch64_abs(op.src);
+        if ((op.type == BOPT_P_NEXT || op.type == BOPT_P_PREV || op.type == BOPT_P_SCAN)
+                && budgie_aarch64_abs(op.arg) > reach) {
+            reach = budgie_aarch64_abs(op.arg);
+        }
+        if (op.type == BOPT_D_OUT) use_out = 1;
+        else if (op.type == BOPT_D_IN) use_in = 1;
+        else if (op.type == BOPT_F_LOPEN && (size_t)op.arg >= nloops) nloops = op.arg + 1;
+    }
+
+    /* ops are a few bytes each in the IR and a few instructions each here */
+    tape_len = opts->start ? opts->start->tape->len : 0;
+    out_len = opts->start ? opts->start->output->len : 0;
+    code = rd_buffer_initsz(4 * in->len + 1024);
+    data = rd_buffer_initsz(tape_len + out_len + 1);
+    st->loop_pos = calloc(nloops + 1, sizeof(*st->loop_pos));
+    if (!st->loop_pos) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    st->out_buffered = use_out && st->io_buffer != BIOB_NONE;
+
+    /* the cells and output worked out at compile time go in data, in that
+     * order */
+    if (opts->start) {
+        rd_buffer_push(&data, rd_buffer_data(opts->start->tape), tape_len);
+        rd_buffer_push(&data, rd_buffer_data(opts->start->output), out_len);
+    }
+
+    /* preamble: set x19 to the first cell of the tape (for a static tape, in
+     * bss), then to where the cell pointer starts. the guard pages have to be
+     * far enough out that nothing skips over them: a move that leaves the
+     * tape, then the furthest offset from there */
+    nrelocs = 0;
+    if (opts->tape == BTAPE_MMAP) {
+        guard = budgie_aarch64_pages(2 * reach * st->cell_sz + 1);
+        budgie_aarch64_tape_map(&code, opts->tape_size * st->cell_sz, guard);
+        budgie_aarch64_addi(&code, 1, R_CELL, R_CELL, BUDGIE_TAPE_START(opts) * st->cell_sz);
+    } else {
+        budgie_aarch64_addr(&code, R_CELL, &relocs[nrelocs++], RELOC_BSS64, 0);
+    }
+
+    if (tape_len) {
+        /* start the cells off as they were left at compile time
+         *  ldr x10, <start of data>
+         *  mov x11, x19
+         *  mov x12, <number of bytes>
+         * .copy:
+         *  ldrb w13, [x10], #1
+         *  strb w13, [x11], #1
+         *  subs x12, x12, #1
+         *  b.ne .copy
+         */
+        budgie_aarch64_addr(&code, 10, &relocs[nrelocs++], RELOC_DATA64, 0);
+        budgie_aarch64_movr(&code, 11, R_CELL);
+        budgie_aarch64_mov(&code, 1, 12, tape_len);
+        copy_pos = code->len;
+        budgie_aarch64_insn(&code, 0x3840154D);
+        budgie_aarch64_insn(&code, 0x3800156D);
+        budgie_aarch64_insn(&code, 0xF100058C);
+        budgie_aarch64_insn(&code, budgie_aarch64_bcond(0x54000001, (int64_t)copy_pos - (int64_t)code->len));
+        budgie_aarch64_op_move(st, &code, opts->start->pos);
+    }
+
+    /* the runtime routines go here, so jump over them (b .over) */
+    jmp_pos = code->len;
+    budgie_aarch64_insn(&code, 0x14000000);
+    if (st->out_buffered || out_len) budgie_aarch64_rt_flush(st, &code);
+    if (use_in) budgie_aarch64_rt_getc(st, &code);
+    budgie_aarch64_patch(code, jmp_pos, code->len);
+
+    if (out_len) {
+        /* print the output worked out at compile time
+         *  ldr x1, <the output in data>
+         *  mov x2, <number of bytes>
+         *  bl write
+         */
+        budgie_aarch64_addr(&code, 1, &relocs[nrelocs++], RELOC_DATA64, tape_len);
+        budgie_aarch64_mov(&code, 1, 2, out_len);
+        budgie_aarch64_insn(&code, budgie_aarch64_b(0x94000000, code->len, st->write_pos));
+    }
+
+    /* the output buffer goes in bss after the cells, then the input buffer */
+    outbuf = bss_size;
+    if (st->out_buffered) {
+        /* ldr x20, <output buffer>
+         * mov x21, #0 ; the buffer starts out empty
+         */
+        budgie_aarch64_addr(&code, R_OUT, &relocs[nrelocs++], RELOC_BSS64, outbuf);
+        budgie_aarch64_mov(&code, 1, R_OUTN, 0);
+        bss_size += BUDGIE_OUTBUF_SZ;
+    }
+    if (use_in) {
+        /* ldr x22, <input buffer>
+         * mov x23, x22 ; the buffer starts out empty (x23 == x24)
+         * mov x24, x22
+         */
+        budgie_aarch64_addr(&code, R_IN, &relocs[nrelocs++], RELOC_BSS64, bss_size);
+        budgie_aarch64_movr(&code, R_INPOS, R_IN);
+        budgie_aarch64_movr(&code, R_INEND, R_IN);
+        bss_size += BUDGIE_INBUF_SZ;
+    }
+    relocs[nrelocs].type = RELOC_NULL;
+
+    /* translate each instruction */
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        switch (op.type) {
+        case BOPT_P_NEXT:   budgie_aarch64_op_move(st, &code, op.arg); break;
+        case BOPT_P_PREV:   budgie_aarch64_op_move(st, &code, -(int64_t)op.arg); break;
+        case BOPT_D_INCR:   budgie_aarch64_op_incr(st, &code, op.arg, op.off); break;
+        case BOPT_D_DECR:   budgie_aarch64_op_incr(st, &code, 0 - (uint32_t)op.arg, op.off); break;
+        case BOPT_D_OUT:    budgie_aarch64_op_out(st, &code, op.off); break;
+        case BOPT_D_IN:     budgie_aarch64_op_in(st, &code, op.off); break;
+        case BOPT_F_LOPEN:  budgie_aarch64_op_lopen(st, &code, op.arg); break;
+        case BOPT_F_LCLOS:  budgie_aarch64_op_lclos(st, &code, op.arg); break;
+        case BOPT_D_SET:    budgie_aarch64_op_set(st, &code, op.arg, op.off); break;
+        case BOPT_D_MULA:   budgie_aarch64_op_mula(st, &code, op.arg, op.off, op.src); break;
+        case BOPT_P_SCAN:   budgie_aarch64_op_scan(st, &code, op.arg); break;
+        default: break;
+        }
+    }
+
+    /* epilogue: write out whatever is still buffered, then exit with code 0
+     *  bl flush
+     *  mov x0, #0
+     *  mov x8, #93 ; (93 = exit)
+     *  svc #0
+     */
+    if (st->out_buffered) budgie_aarch64_insn(&code, budgie_aarch64_b(0x94000000, code->len, st->flush_pos));
+    budgie_aarch64_mov(&code, 1, 0, 0);
+    budgie_aarch64_syscall(&code, 93);
+
+    /* every branch and call has to be able to reach anywhere in the code */
+    if (code->len >= BUDGIE_BRANCH_MAX) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    if (opts->stats) opts->stats->code_bytes = code->len;
+
+    /* final linking */
+    /* with the tape mapped and no i/o, nothing goes in bss, but the linker
+     * can't make an empty one */
+    if (!bss_size) bss_size = 1;
+    rc = rd_elf_link64(RD_ELFHDR_MACHINE_AARCH64, code, data, bss_size, relocs, out);
+
+cleanup:
+    rd_buffer_free(data);
+    rd_buffer_free(code);
+    free(st->loop_pos);
+    return rc;
+}
@@ -1,73 +1,592 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include <rudolph/buffer.h>
 #include <rudolph/elf_link.h>
 #include "ir.h"
-#include "stack.h"
+#include "options.h"
+#include "peval.h"
+#include "profile.h"
+#include "stats.h"
+#include "x86_64_linux.h"
 
-#define BUDGIE_MAX_CELLS 131072
+#define BUDGIE_OUTBUF_SZ 65536
+#define BUDGIE_INBUF_SZ 65536
+#define BUDGIE_PAGE_SZ 4096
+#define BUDGIE_CODE_START 0xB0 /* where rd_elf_link64 puts the code, past the
+                                * headers, in the file and in memory */
+#define BUDGIE_NOP_MAX 9 /* longest nop budgie_translate_align uses */
+#define BUDGIE_COUNT_MAX 7 /* most bytes counting a loop iteration takes */
 #define c(x) ((const unsigned char *)(x))
 
-static budgie_stack *loop_stack;
+/* the kinds of code that hardly ever runs, which goes after everything else
+ * so it doesn't take up room between the code that does */
+enum budgie_x86_cold_type {
+    BCOLD_FLUSH, /* the output buffer needs flushing: call flush */
+    BCOLD_GETC, /* the input buffer is empty: call getc for a cell */
+    BCOLD_TAPE_FAIL /* the tape couldn't be mapped: give up */
+};
+
+/* a piece of cold code, and the jumps to it */
+struct budgie_x86_cold {
+    enum budgie_x86_cold_type type;
+    size_t jump[2]; /* where the rel32 of each jump to it ends (or 0) */
+    size_t back; /* where it jumps back to when it's done */
+    int32_t off; /* the cell getc reads into */
+};
+
+/* everything about the program being translated that the code generated for
+ * one op depends on. each translation has its own, so several programs can be
+ * translated at the same time */
+struct budgie_x86_state {
+    enum budgie_io_buffer io_buffer;
+    int out_buffered; /* 1 if `.` appends to the output buffer */
+    size_t flush_pos; /* offset of the output flush routine in the code */
+    size_t getc_pos; /* offset of the input refill routine in the code */
+    char *loop_near; /* 1 for each loop that needs near jumps */
+    size_t *loop_pos; /* where the jump in each open loop's lopen ends */
+    size_t *loop_body; /* and where its body starts, which lclos jumps to */
+    char *loop_align; /* 1 for each loop whose body gets aligned */
+    size_t align_bytes; /* what to align them to */
+    size_t code_base; /* where the code starts in memory, modulo a page */
+    int instrument; /* 1 if every loop counts its iterations */
+    struct budgie_x86_cold *cold; /* cold code jumped to so far */
+    size_t ncold; /* how much of it */
+    int relax; /* 1 if a loop turned out to need near jumps */
+    int zf_cell; /* 1 if ZF is set according to the current cell */
+    int dl_cached; /* 1 if dl holds the current cell */
+    int dl_dirty; /* 1 if dl holds a newer value than the current cell */
+    int cell_sz; /* bytes per cell (1, 2 or 4) */
+    uint32_t cell_mask; /* the bits of a cell */
+};
+
+/* the most bytes of code one op of each type can take, including writing back
+ * or loading the cached cell around it and its cold code, with any cell size.
+ * with these the code buffer is allocated big enough up front, instead of
+ * growing it over and over for big programs */
+static const unsigned char budgie_translate_op_max[BOPT_P_SCAN + 1] = {
+    10, /* BOPT_P_NEXT */
+    10, /* BOPT_P_PREV */
+    14, /* BOPT_D_INCR */
+    14, /* BOPT_D_DECR */
+    44, /* BOPT_D_OUT */
+    50, /* BOPT_D_IN */
+    15, /* BOPT_F_LOPEN */
+    15, /* BOPT_F_LCLOS */
+    0, /* BOPT_NOOP */
+    11, /* BOPT_D_SET */
+    20, /* BOPT_D_MULA */
+    83 /* BOPT_P_SCAN */
+};
+#define BUDGIE_RUNTIME_MAX 1024 /* and the most the rest of the code takes */
+#define BUDGIE_IDIOM_MAX 2 /* most ops translated together as an idiom */
+
+/* the recommended nop of each length, for padding that gets run through */
+static const char *const budgie_translate_nops[BUDGIE_NOP_MAX + 1] = {
+    "",
+    "\x90",
+    "\x66\x90",
+    "\x0F\x1F\x00",
+    "\x0F\x1F\x40\x00",
+    "\x0F\x1F\x44\x00\x00",
+    "\x66\x0F\x1F\x44\x00\x00",
+    "\x0F\x1F\x80\x00\x00\x00\x00",
+    "\x0F\x1F\x84\x00\x00\x00\x00\x00",
+    "\x66\x0F\x1F\x84\x00\x00\x00\x00\x00"
+};
+
+/* instructions that work on a whole cell come in three sizes. byte cells use
+ * the byte form <op8> of the opcode, 16 bit ones the full size form <op> with
+ * an operand size prefix, and 32 bit ones just <op>. which register "dl"
+ * means (dl, dx or edx) goes the same way */
+__inline static void budgie_translate_opc(struct budgie_x86_state *st, rd_buf_t **buf, unsigned char op8,
+                                          unsigned char op) {
+    if (st->cell_sz == 1) {
+        rd_buffer_push(buf, &op8, 1);
+        return;
+    }
+    if (st->cell_sz == 2) rd_buffer_push(buf, c("\x66"), 1);
+    rd_buffer_push(buf, &op, 1);
+}
+
+/* size of what budgie_translate_opc emits */
+__inline static size_t budgie_translate_opc_sz(struct budgie_x86_state *st) {
+    return st->cell_sz == 2 ? 2 : 1;
+}
+
+/* an immediate as wide as a cell */
+__inline static void budgie_translate_imm(struct budgie_x86_state *st, rd_buf_t **buf, uint32_t v) {
+    unsigned char imm[4];
+
+    imm[0] = v;
+    imm[1] = v >> 8;
+    imm[2] = v >> 16;
+    imm[3] = v >> 24;
+    rd_buffer_push(buf, imm, st->cell_sz);
+}
+
+/* whether <v> (one cell's worth of bits) fits in a sign-extended imm8 */
+__inline static int budgie_translate_imm8(struct budgie_x86_state *st, uint32_t v) {
+    return (v & st->cell_mask) <= 0x7F || (v | ~st->cell_mask | 0x7F) == 0xFFFFFFFF;
+}
+
+/* pad with as few nops as it takes for the next instruction to start at a
+ * multiple of <align> bytes in memory */
+__inline static void budgie_translate_align(struct budgie_x86_state *st, rd_buf_t **buf, size_t align) {
+    size_t pad, n;
+
+    pad = (align - (st->code_base + (*buf)->len) % align) % align;
+    for (; pad; pad -= n) {
+        n = pad < BUDGIE_NOP_MAX ? pad : BUDGIE_NOP_MAX;
+        rd_buffer_push(buf, c(budgie_translate_nops[n]), n);
+    }
+}
+
+__inline static void budgie_translate_call(rd_buf_t **buf, size_t target) {
+    int32_t diff;
+
+    /* call $+0x00000000 */
+    diff = target - ((*buf)->len + 5);
+    rd_buffer_push(buf, c("\xE8"), 1);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&diff), 4);
+}
+
+/* j<cc> rel32 (<jcc> being the second byte of the near form) to <cold>, as
+ * its <i>th jump, to be filled in once it's known where that goes */
+__inline static void budgie_translate_cold_jump(rd_buf_t **buf, unsigned char jcc, struct budgie_x86_cold *cold,
+                                                int i) {
+    rd_buffer_push(buf, c("\x0F"), 1);
+    rd_buffer_push(buf, &jcc, 1);
+    rd_buffer_push(buf, c("\x00\x00\x00\x00"), 4);
+    cold->jump[i] = (*buf)->len;
+}
+
+/* jump to a new piece of cold code, which gets put after everything else
+ * once the rest of the code is done */
+__inline static struct budgie_x86_cold *budgie_translate_cold(struct budgie_x86_state *st, rd_buf_t **buf,
+                                                              unsigned char jcc,
+                                                              enum budgie_x86_cold_type type) {
+    struct budgie_x86_cold *cold;
+
+    cold = &st->cold[st->ncold++];
+    memset(cold, 0, sizeof(*cold));
+    cold->type = type;
+    budgie_translate_cold_jump(buf, jcc, cold, 0);
+    return cold;
+}
+
+__inline static void budgie_translate_rt_flush(struct budgie_x86_state *st, rd_buf_t **buf) {
+    /* the output buffer lives in bss right after the cells; r14 holds its
+     * address and r13 holds the number of bytes currently in it.
+     *
+     * flush:
+     *  push rsi ; rsi is the cell pointer, so keep it safe
+     *  push rdx ; and dl may be holding the current cell
+     *  mov rsi, r14 ; start writing from the start of the buffer
+     * .loop:
+     *  test r13, r13 ; anything left to write?
+     *  jz .done
+     *  mov rax, r12 ; r12 is set to 1 initially - rax = 1 = sys_write
+     *  mov rdi, r12 ; r12 is set to 1 initially - rdi = 1 = stdout
+     *  mov rdx, r13 ; rdx = number of bytes left
+     *  syscall
+     *  test rax, rax ; on error, just drop whatever is left
+     *  jle .done
+     *  add rsi, rax ; short writes continue where they left off
+     *  sub r13, rax
+     *  jmp .loop
+     * .done:
+     *  xor r13d, r13d ; buffer is empty again
+     *  pop rdx
+     *  pop rsi
+     *  ret
+     */
+    st->flush_pos = (*buf)->len;
+    rd_buffer_push(buf, c("\x56" "\x52" "\x4C\x89\xF6"
+                          "\x4D\x85\xED" "\x74\x18"
+                          "\x4C\x89\xE0" "\x4C\x89\xE7" "\x4C\x89\xEA" "\x0F\x05"
+                          "\x48\x85\xC0" "\x7E\x08"
+                          "\x48\x01\xC6" "\x49\x29\xC5" "\xEB\xE3"
+                          "\x45\x31\xED" "\x5A" "\x5E" "\xC3"), 40);
+}
+
+/* round <n> up to a whole number of pages */
+__inline static size_t budgie_translate_pages(size_t n) {
+    return (n + BUDGIE_PAGE_SZ - 1) / BUDGIE_PAGE_SZ * BUDGIE_PAGE_SZ;
+}
+
+/* map a tape of <cells> cells with <guard> bytes of inaccessible pages on
+ * either side, so going off either end of it faults right away instead of
+ * scribbling over something else. the pages of the tape only take up memory
+ * once they're used. leaves the address of the cell <start> in rdx, and with
+ * <jit>, the address of the mapping on the stack so it can be unmapped at the
+ * end. if the tape can't be mapped, the program exits with code 1 (or returns
+ * 1 with <jit>) from cold code */
+static void budgie_translate_tape_map(struct budgie_x86_state *st, rd_buf_t **buf, int jit, size_t cells,
+                                      size_t guard, size_t start) {
+    struct budgie_x86_cold *fail;
+    size_t len;
+
+    /* mmap(NULL, <length>, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+     *  xor edi, edi
+     *  movabs rsi, <length>
+     *  xor edx, edx
+     *  mov r10d, 0x4022
+     *  or r8, -1
+     *  xor r9d, r9d
+     *  mov eax, 9 ; (9 = mmap)
+     *  syscall
+     *  push rax ; (only with jit)
+     *  test rax, rax ; errors are negative
+     *  js .fail ; (a near jump to cold code)
+     */
+    len = 2 * guard + budgie_translate_pages(cells);
+    rd_buffer_push(buf, c("\x31\xFF" "\x48\xBE"), 4);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&len), 8);
+    rd_buffer_push(buf, c("\x31\xD2" "\x41\xBA\x22\x40\x00\x00" "\x49\x83\xC8\xFF" "\x45\x31\xC9"
+                          "\xB8\x09\x00\x00\x00" "\x0F\x05"), 22);
+    if (jit) rd_buffer_push(buf, c("\x50"), 1);
+    rd_buffer_push(buf, c("\x48\x85\xC0"), 3);
+    fail = budgie_translate_cold(st, buf, 0x88, BCOLD_TAPE_FAIL);
+
+    /* then make the tape itself accessible
+     * mprotect(<mapping> + <guard>, <tape length>, PROT_READ | PROT_WRITE)
+     *  movabs rdi, <guard>
+     *  add rdi, rax
+     *  movabs rsi, <tape length>
+     *  mov edx, 3
+     *  mov eax, 10 ; (10 = mprotect)
+     *  syscall
+     *  test eax, eax
+     *  jnz .fail ; (same)
+     */
+    rd_buffer_push(buf, c("\x48\xBF"), 2);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&guard), 8);
+    len = budgie_translate_pages(cells);
+    rd_buffer_push(buf, c("\x48\x01\xC7" "\x48\xBE"), 5);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&len), 8);
+    rd_buffer_push(buf, c("\xBA\x03\x00\x00\x00" "\xB8\x0A\x00\x00\x00" "\x0F\x05"
+                          "\x85\xC0"), 14);
+    budgie_translate_cold_jump(buf, 0x85, fail, 1);
+
+    /* movabs rdx, <start>
+     * add rdx, rdi
+     */
+    rd_buffer_push(buf, c("\x48\xBA"), 2);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&start), 8);
+    rd_buffer_push(buf, c("\x48\x01\xFA"), 3);
+}
+
+__inline static void budgie_translate_rt_getc(struct budgie_x86_state *st, rd_buf_t **buf,
+                                              enum budgie_eof eof, struct rd_elf_link_relocation *reloc,
+                                              size_t inbuf) {
+    int32_t sz;
+    unsigned char jle;
+
+    /* the input buffer lives in bss too; rbp points to the next unread byte
+     * and r15 to the end of what was read, so it is empty when rbp == r15.
+     * this routine is only called when the buffer is empty, and reads the
+     * next byte into [rsi] after refilling the buffer.
+     */
+    st->getc_pos = (*buf)->len;
+
+    /* we're about to block, so anything written so far has to be visible */
+    if (st->out_buffered) budgie_translate_call(buf, st->flush_pos);
+
+    /* without buffering, only ever ask for a single byte so that nothing
+     * past what the program reads gets taken from stdin */
+    sz = st->io_buffer == BIOB_NONE ? 1 : BUDGIE_INBUF_SZ;
+
+    /*
+     * push rsi ; rsi is the cell pointer, so keep it safe
+     * mov rax, rbx ; rbx is set to 0 initially = 0 = sys_read
+     * mov rdi, rbx ; rbx is set to 0 initially = 0 = stdin
+     * movabs rsi, 0x00 ; (will be relocated to the input buffer)
+     * mov edx, <size of the input buffer>
+     * syscall
+     */
+    rd_buffer_push(buf, c("\x56" "\x48\x89\xD8" "\x48\x89\xDF" "\x48\xBE"), 9);
+    reloc->type = RELOC_BSS64;
+    reloc->target = (*buf)->len;
+    reloc->src = inbuf;
+    rd_buffer_push(buf, c("\x00\x00\x00\x00\x00\x00\x00\x00" "\xBA"), 9);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&sz), 4);
+
+    /*
+     * syscall
+     * mov rbp, rsi ; the buffer starts at the beginning again
+     * pop rsi
+     * test rax, rax ; nothing read (or an error) is treated as eof
+     * jle .eof
+     * lea r15, [rbp+rax] ; end of what was read
+     * mov al, [rbp] ; hand out the first byte
+     * (or movzx eax, byte [rbp], for wider cells)
+     * inc rbp
+     * mov [rsi], al ; (or ax or eax)
+     * ret
+     * .eof:
+     * mov r15, rbp ; leave the buffer empty so the next `,` tries again
+     */
+    jle = 5 + (st->cell_sz == 1 ? 3 : 4) + 3 + budgie_translate_opc_sz(st) + 1 + 1;
+    rd_buffer_push(buf, c("\x0F\x05" "\x48\x89\xF5" "\x5E" "\x48\x85\xC0" "\x7E"), 10);
+    rd_buffer_push(buf, &jle, 1);
+    rd_buffer_push(buf, c("\x4C\x8D\x7C\x05\x00"), 5);
+    if (st->cell_sz == 1) rd_buffer_push(buf, c("\x8A\x45\x00"), 3);
+    else rd_buffer_push(buf, c("\x0F\xB6\x45\x00"), 4);
+    rd_buffer_push(buf, c("\x48\xFF\xC5"), 3);
+    budgie_translate_opc(st, buf, 0x88, 0x89);
+    rd_buffer_push(buf, c("\x06" "\xC3" "\x49\x89\xEF"), 5);
+
+    switch (eof) {
+    case BEOF_ZERO:
+        /* mov [rsi], 0 */
+        budgie_translate_opc(st, buf, 0xC6, 0xC7);
+        rd_buffer_push(buf, c("\x06"), 1);
+        budgie_translate_imm(st, buf, 0);
+        break;
+    case BEOF_MINUS_ONE:
+        /* mov [rsi], -1 */
+        budgie_translate_opc(st, buf, 0xC6, 0xC7);
+        rd_buffer_push(buf, c("\x06"), 1);
+        budgie_translate_imm(st, buf, st->cell_mask);
+        break;
+    default: break;
+    }
+
+    /* ret */
+    rd_buffer_push(buf, c("\xC3"), 1);
+}
+
+/* the current cell is kept in dl between ops that don't move the pointer,
+ * and only written back to the tape when something else needs to see it */
+__inline static void budgie_translate_dl_load(struct budgie_x86_state *st, rd_buf_t **buf) {
+    /* mov dl, [rsi] */
+    if (!st->dl_cached) {
+        budgie_translate_opc(st, buf, 0x8A, 0x8B);
+        rd_buffer_push(buf, c("\x16"), 1);
+    }
+    st->dl_cached = 1;
+}
+
+__inline static void budgie_translate_dl_store(struct budgie_x86_state *st, rd_buf_t **buf) {
+    /* mov [rsi], dl */
+    if (st->dl_dirty) {
+        budgie_translate_opc(st, buf, 0x88, 0x89);
+        rd_buffer_push(buf, c("\x16"), 1);
+    }
+    st->dl_dirty = 0;
+}
+
+__inline static void budgie_translate_dl_drop(struct budgie_x86_state *st, rd_buf_t **buf) {
+    /* write it back and forget about it (the pointer moves, or rdx is about
+     * to get clobbered) */
+    budgie_translate_dl_store(st, buf);
+    st->dl_cached = 0;
+}
+
+__inline static void budgie_translate_op_next(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg) {
+    unsigned char imm;
+
+    budgie_translate_dl_drop(st, buf);
+    arg *= st->cell_sz; /* the code checked that this fits */
 
-__inline static void budgie_translate_op_next(rd_buf_t **buf, unsigned char arg) {
     if (arg == 1) {
         /* inc rsi */
         rd_buffer_push(buf, c("\x48\xFF\xC6"), 3);
     } else if (arg <= 127) {
         /* add rsi, <number less than or equal to 127> */
+        imm = arg;
         rd_buffer_push(buf, c("\x48\x83\xC6"), 3);
-        rd_buffer_push(buf, &arg, 1);
+        rd_buffer_push(buf, &imm, 1);
     } else {
         /* add rsi, <number greater than 127> */
         rd_buffer_push(buf, c("\x48\x81\xC6"), 3);
-        rd_buffer_push(buf, &arg, 1);
-        /* we only have a maximum of 1 byte, so pad the rest with zero */
-        rd_buffer_push(buf, c("\x00\x00\x00"), 3);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&arg), 4);
     }
 }
 
-__inline static void budgie_translate_op_prev(rd_buf_t **buf, unsigned char arg) {
+__inline static void budgie_translate_op_prev(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg) {
+    unsigned char imm;
+
+    budgie_translate_dl_drop(st, buf);
+    arg *= st->cell_sz;
+
     if (arg == 1) {
         /* dec rsi */
         rd_buffer_push(buf, c("\x48\xFF\xCE"), 3);
-    } else if (arg <= 127) {
-        /* sub rsi, <number less than or equal to 127> */
-        rd_buffer_push(buf, c("\x48\x83\xEE"), 3);
-        rd_buffer_push(buf, &arg, 1);
+    } else if (arg <= 128) {
+        /* add rsi, <number greater than or equal to -128> */
+        imm = -arg;
+        rd_buffer_push(buf, c("\x48\x83\xC6"), 3);
+        rd_buffer_push(buf, &imm, 1);
     } else {
-        /* sub rsi, <number greater than 127> */
+        /* sub rsi, <number greater than 128> */
         rd_buffer_push(buf, c("\x48\x81\xEE"), 3);
-        rd_buffer_push(buf, &arg, 1);
-        /* we only have a maximum of 1 byte, so pad the rest with zero */
-        rd_buffer_push(buf, c("\x00\x00\x00"), 3);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&arg), 4);
     }
 }
 
-__inline static void budgie_translate_op_incr(rd_buf_t **buf, unsigned char arg) {
-    if (arg == 1) {
-        /* incb [rsi] */
-        rd_buffer_push(buf, c("\xFE\x06"), 2);
+__inline static size_t budgie_translate_abs(int32_t x) {
+    return x < 0 ? -(size_t)x : (size_t)x;
+}
+
+__inline static void budgie_translate_cell(struct budgie_x86_state *st, rd_buf_t **buf,
+                                           unsigned char reg, int32_t off) {
+    unsigned char modrm[2];
+
+    /* modrm byte (and displacement) for the cell at [rsi+<offset>], with
+     * <reg> in the reg field (either a register or an opcode extension) */
+    off *= st->cell_sz;
+    if (off == 0) {
+        /* [rsi] */
+        modrm[0] = 0x06 | (reg << 3);
+        rd_buffer_push(buf, modrm, 1);
+    } else if (off >= -128 && off <= 127) {
+        /* [rsi+<8 bit offset>] */
+        modrm[0] = 0x46 | (reg << 3);
+        modrm[1] = off;
+        rd_buffer_push(buf, modrm, 2);
     } else {
-        /* addb [rsi], <number less than or equal to 255> */
-        rd_buffer_push(buf, c("\x80\x06"), 2);
-        rd_buffer_push(buf, &arg, 1);
+        /* [rsi+<32 bit offset>] */
+        modrm[0] = 0x86 | (reg << 3);
+        rd_buffer_push(buf, modrm, 1);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&off), 4);
     }
 }
 
-__inline static void budgie_translate_op_decr(rd_buf_t **buf, unsigned char arg) {
-    if (arg == 1) {
-        /* decb [rsi] */
-        rd_buffer_push(buf, c("\xFE\x0E"), 2);
+/* lea rsi, [rsi+<offset>] */
+__inline static void budgie_translate_move(struct budgie_x86_state *st, rd_buf_t **buf, int32_t off) {
+    if (off == 0) return;
+    rd_buffer_push(buf, c("\x48\x8D"), 2);
+    budgie_translate_cell(st, buf, 6, off);
+}
+
+/* add <imm> (already cut down to the bits of a cell) to the cell <off> away
+ * in memory, leaving dl alone */
+__inline static void budgie_translate_add_cell(struct budgie_x86_state *st, rd_buf_t **buf, uint32_t imm,
+                                               int32_t off) {
+    unsigned char imm8;
+
+    imm8 = imm;
+    if (imm == 1) {
+        /* inc [rsi+<offset>] */
+        budgie_translate_opc(st, buf, 0xFE, 0xFF);
+        budgie_translate_cell(st, buf, 0, off);
+    } else if (imm == st->cell_mask) {
+        /* dec [rsi+<offset>] */
+        budgie_translate_opc(st, buf, 0xFE, 0xFF);
+        budgie_translate_cell(st, buf, 1, off);
+    } else if (st->cell_sz > 1 && budgie_translate_imm8(st, imm)) {
+        /* add [rsi+<offset>], <sign-extended byte> */
+        budgie_translate_opc(st, buf, 0x83, 0x83);
+        budgie_translate_cell(st, buf, 0, off);
+        rd_buffer_push(buf, &imm8, 1);
+    } else {
+        /* add [rsi+<offset>], <number that fits in a cell> */
+        budgie_translate_opc(st, buf, 0x80, 0x81);
+        budgie_translate_cell(st, buf, 0, off);
+        budgie_translate_imm(st, buf, imm);
+    }
+}
+
+__inline static void budgie_translate_op_incr(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                              int32_t off) {
+    uint32_t imm;
+    unsigned char imm8;
+
+    /* cells wrap around, so only the bits of a cell count */
+    imm = (uint32_t)arg & st->cell_mask;
+    imm8 = imm;
+    if (imm == 0) {
+        return;
+    } else if (off == 0) {
+        /* the current cell gets cached */
+        budgie_translate_dl_load(st, buf);
+        st->dl_dirty = 1;
+        if (imm == 1) {
+            /* inc dl */
+            budgie_translate_opc(st, buf, 0xFE, 0xFF);
+            rd_buffer_push(buf, c("\xC2"), 1);
+        } else if (imm == st->cell_mask) {
+            /* dec dl */
+            budgie_translate_opc(st, buf, 0xFE, 0xFF);
+            rd_buffer_push(buf, c("\xCA"), 1);
+        } else if (st->cell_sz > 1 && budgie_translate_imm8(st, imm)) {
+            /* add dx, <sign-extended byte> (or edx) */
+            budgie_translate_opc(st, buf, 0x83, 0x83);
+            rd_buffer_push(buf, c("\xC2"), 1);
+            rd_buffer_push(buf, &imm8, 1);
+        } else {
+            /* add dl, <number that fits in a cell> */
+            budgie_translate_opc(st, buf, 0x80, 0x81);
+            rd_buffer_push(buf, c("\xC2"), 1);
+            budgie_translate_imm(st, buf, imm);
+        }
     } else {
-        /* subb [rsi], <number less than or equal to 255> */
-        rd_buffer_push(buf, c("\x80\x2E"), 2);
-        rd_buffer_push(buf, &arg, 1);
+        budgie_translate_add_cell(st, buf, imm, off);
     }
 }
 
-__inline static void budgie_translate_op_out(rd_buf_t **buf, unsigned char arg) {
+__inline static void budgie_translate_op_decr(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                              int32_t off) {
+    /* subtracting is adding the negative */
+    budgie_translate_op_incr(st, buf, (int32_t)(0 - ((uint32_t)arg & st->cell_mask)), off);
+}
+
+/* get the lowest byte of the cell <off> away into al, to print it */
+__inline static void budgie_translate_out_load(struct budgie_x86_state *st, rd_buf_t **buf, int32_t off) {
+    if (off == 0 && st->dl_cached) {
+        /* mov al, dl */
+        rd_buffer_push(buf, c("\x88\xD0"), 2);
+    } else {
+        /* mov al, [rsi+<offset>] */
+        rd_buffer_push(buf, c("\x8A"), 1);
+        budgie_translate_cell(st, buf, 0, off);
+    }
+}
+
+__inline static void budgie_translate_op_out(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                             int32_t off) {
+    struct budgie_x86_cold *flush;
+    int32_t sz;
+
+    if (st->out_buffered) {
+        budgie_translate_out_load(st, buf, off);
+
+        /*
+         * mov [r14+r13], al ; append it to the output buffer
+         * inc r13
+         */
+        rd_buffer_push(buf, c("\x43\x88\x04\x2E" "\x49\xFF\xC5"), 7);
+
+        /*
+         * cmp al, 0x0A ; newlines flush right away (only with BIOB_LINE)
+         * je .flush
+         * cmp r13, BUDGIE_OUTBUF_SZ ; check if the buffer is full
+         * jae .flush ; (cold code that calls flush and comes back)
+         */
+        flush = NULL;
+        if (st->io_buffer == BIOB_LINE) {
+            rd_buffer_push(buf, c("\x3C\x0A"), 2);
+            flush = budgie_translate_cold(st, buf, 0x84, BCOLD_FLUSH);
+        }
+        sz = BUDGIE_OUTBUF_SZ;
+        rd_buffer_push(buf, c("\x49\x81\xFD"), 3);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&sz), 4);
+        if (flush) budgie_translate_cold_jump(buf, 0x83, flush, 1);
+        else flush = budgie_translate_cold(st, buf, 0x83, BCOLD_FLUSH);
+        flush->back = (*buf)->len;
+        return;
+    }
+
+    /* the syscall reads the tape and clobbers rdx */
+    budgie_translate_dl_drop(st, buf);
+
+    /* lea rsi, [rsi+<offset>] ; write from the right cell */
+    budgie_translate_move(st, buf, off);
+
     /*
      * mov rax, r12 ; r12 is set to 1 initially - rax = 1 = sys_write
      * mov rdi, r12 ; r12 is set to 1 initially - rdi = 1 = stdout
@@ -76,107 +595,681 @@ __inline static void budgie_translate_op_out(rd_buf_t **buf, unsigned char arg)
      *         ; to, rdx = 1 byte
      */
     rd_buffer_push(buf, c("\x4C\x89\xE0" "\x4C\x89\xE7" "\x4C\x89\xE2" "\x0F\x05"), 11);
+
+    /* lea rsi, [rsi-<offset>] ; and go back to the current cell */
+    budgie_translate_move(st, buf, -off);
 }
 
-__inline static void budgie_translate_op_in(rd_buf_t **buf, unsigned char arg) {
+__inline static void budgie_translate_op_in(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                            int32_t off) {
+    struct budgie_x86_cold *getc;
+
+    /* getc clobbers rdx, and leaves the cell alone at eof */
+    budgie_translate_dl_drop(st, buf);
+
     /*
-     * mov rax, rbx ; rbx is set to 0 initially = 0 = sys_read
-     * mov rdi, rbx ; rbx is set to 0 initially = 0 = stdin
-     * mov rdx, r12 ; r12 is set to 1 initially - rdx = 1 = 1 byte
-     * syscall ; rax = 0 = sys_read, rdi = 1 = stdin, rsi = address to write to,
-     *         ; rdx = 1 byte
+     * cmp rbp, r15 ; check if the input buffer is empty
+     * jae .getc ; refill it if so, in cold code that comes back after this
+     * mov al, [rbp] ; otherwise, just take the next byte out of it
+     * (or movzx eax, byte [rbp], for wider cells)
+     * inc rbp
      */
-    rd_buffer_push(buf, c("\x48\x89\xD8" "\x48\x89\xDF" "\x4C\x89\xE2" "\x0F\x05"), 11);
+    rd_buffer_push(buf, c("\x4C\x39\xFD"), 3);
+    getc = budgie_translate_cold(st, buf, 0x83, BCOLD_GETC);
+    getc->off = off;
+    if (st->cell_sz == 1) rd_buffer_push(buf, c("\x8A\x45\x00"), 3);
+    else rd_buffer_push(buf, c("\x0F\xB6\x45\x00"), 4);
+    rd_buffer_push(buf, c("\x48\xFF\xC5"), 3);
+
+    /* mov [rsi+<offset>], al (or ax or eax) */
+    budgie_translate_opc(st, buf, 0x88, 0x89);
+    budgie_translate_cell(st, buf, 0, off);
+    getc->back = (*buf)->len;
+}
+
+/* write the current cell back and have it cached, which is the state at
+ * every loop label, then check if it is 0 */
+__inline static void budgie_translate_loop_test(struct budgie_x86_state *st, rd_buf_t **buf) {
+    budgie_translate_dl_store(st, buf);
+    budgie_translate_dl_load(st, buf);
+
+    /* test dl, dl ; check if the cell is 0 (unless the flags already say) */
+    if (!st->zf_cell) {
+        budgie_translate_opc(st, buf, 0x84, 0x85);
+        rd_buffer_push(buf, c("\xD2"), 1);
+    }
+}
+
+/* count an iteration of the loop <loop>. r9 points to the counters, one 64
+ * bit one per loop */
+__inline static void budgie_translate_count(rd_buf_t **buf, size_t loop) {
+    int32_t disp;
+    unsigned char disp8;
+
+    disp = loop * 8; /* the code checked that this fits */
+    disp8 = disp;
+    if (disp == 0) {
+        /* inc qword [r9] */
+        rd_buffer_push(buf, c("\x49\xFF\x01"), 3);
+    } else if (disp <= 127) {
+        /* inc qword [r9+<8 bit offset>] */
+        rd_buffer_push(buf, c("\x49\xFF\x41"), 3);
+        rd_buffer_push(buf, &disp8, 1);
+    } else {
+        /* inc qword [r9+<32 bit offset>] */
+        rd_buffer_push(buf, c("\x49\xFF\x81"), 3);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&disp), 4);
+    }
+}
+
+__inline static void budgie_translate_op_lopen(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg) {
+    budgie_translate_loop_test(st, buf);
+
+    /* je $+0x00 ; jump past the matching lclos if the cell is 0
+     * (a near jump if the loop is too big for a short one)
+     * for now the jump destination will be 0 */
+    if (st->loop_near[arg]) rd_buffer_push(buf, c("\x0F\x84\x00\x00\x00\x00"), 6);
+    else rd_buffer_push(buf, c("\x74\x00"), 2);
+
+    /* also keep the location of the jump so we can overwrite it later */
+    st->loop_pos[arg] = (*buf)->len;
+
+    /* the body of an aligned loop starts on a fresh fetch block, so every
+     * time around it gets fetched in as few of them as it can. the padding
+     * only gets run through on the way into the loop */
+    if (st->loop_align[arg]) budgie_translate_align(st, buf, st->align_bytes);
+    st->loop_body[arg] = (*buf)->len;
+    if (st->instrument) budgie_translate_count(buf, arg);
+}
+
+__inline static void budgie_translate_op_lclos(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg) {
+    size_t lopen_pos, body_pos, loop;
+    int32_t diff;
+    unsigned char diff8;
+
+    /* get the location of the lopen of the same loop */
+    loop = arg;
+    lopen_pos = st->loop_pos[loop];
+    body_pos = st->loop_body[loop];
+
+    budgie_translate_loop_test(st, buf);
+
+    if (st->loop_near[loop]) {
+        /* jne $+0x00000000 ; jump back to the start of the loop if the cell
+         *                  ; isn't 0 */
+        rd_buffer_push(buf, c("\x0F\x85"), 2);
+
+        /* find the difference and make the jump go to the start of the body */
+        diff = body_pos - (*buf)->len - 4;
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&diff), 4);
+
+        /* also overwrite the old jump in the lopen that was blank */
+        *((int32_t *)(rd_buffer_data(*buf) + lopen_pos - 4)) = (*buf)->len - lopen_pos;
+    } else {
+        /* jne $+0x00 ; same thing, but short */
+        rd_buffer_push(buf, c("\x75"), 1);
+        diff = body_pos - (*buf)->len - 1;
+        diff8 = diff;
+        rd_buffer_push(buf, &diff8, 1);
+        rd_buffer_data(*buf)[lopen_pos - 1] = (*buf)->len - lopen_pos;
+
+        /* the jump in lopen also covers any padding before the body. if
+         * either one doesn't fit, the code has to be emitted again */
+        if (diff < -128 || (*buf)->len - lopen_pos > 127) {
+            st->loop_near[loop] = 1;
+            st->relax = 1;
+        }
+    }
+}
+
+/* mov [rsi+<offset>], <number to set to> */
+__inline static void budgie_translate_set_cell(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                               int32_t off) {
+    budgie_translate_opc(st, buf, 0xC6, 0xC7);
+    budgie_translate_cell(st, buf, 0, off);
+    budgie_translate_imm(st, buf, arg);
+}
+
+__inline static void budgie_translate_op_set(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                             int32_t off) {
+    if (off == 0) {
+        /* mov dl, <number to set to> */
+        budgie_translate_opc(st, buf, 0xB2, 0xBA);
+        budgie_translate_imm(st, buf, arg);
+        st->dl_cached = st->dl_dirty = 1;
+    } else {
+        budgie_translate_set_cell(st, buf, arg, off);
+    }
+}
+
+__inline static void budgie_translate_op_mula(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg,
+                                              int32_t off, int32_t src) {
+    unsigned char imm, reg, modrm;
+    uint32_t factor;
+
+    if (src == 0) {
+        /* the current cell is the one to multiply, so use it from dl */
+        budgie_translate_dl_load(st, buf);
+        reg = 2;
+    } else {
+        /* mov al, [rsi+<source offset>] ; get the cell to multiply */
+        budgie_translate_opc(st, buf, 0x8A, 0x8B);
+        budgie_translate_cell(st, buf, 0, src);
+        reg = 0;
+    }
+
+    /* only the bits of a cell of the factor matter */
+    factor = (uint32_t)arg & st->cell_mask;
+    if (factor != 1 && factor != st->cell_mask) {
+        /* imul eax, e<a or d>x, <factor> ; only the low bits matter, so the
+         *                                ; factor can be sign-extended and the
+         *                                ; rest of eax can be junk */
+        modrm = 0xC0 | reg;
+        imm = factor;
+        if (budgie_translate_imm8(st, factor)) {
+            rd_buffer_push(buf, c("\x6B"), 1);
+            rd_buffer_push(buf, &modrm, 1);
+            rd_buffer_push(buf, &imm, 1);
+        } else {
+            rd_buffer_push(buf, c("\x69"), 1);
+            rd_buffer_push(buf, &modrm, 1);
+            rd_buffer_push(buf, (unsigned char *)(intptr_t)(&factor), 4);
+        }
+        reg = 0;
+    }
+
+    /* add <cell>, <a or d>l ; or sub for a factor of -1 */
+    if (factor == st->cell_mask) budgie_translate_opc(st, buf, 0x28, 0x29);
+    else budgie_translate_opc(st, buf, 0x00, 0x01);
+    if (off == 0 && st->dl_cached) {
+        /* the cell is dl */
+        modrm = 0xC2 | (reg << 3);
+        rd_buffer_push(buf, &modrm, 1);
+        st->dl_dirty = 1;
+    } else {
+        /* [rsi+<offset>] */
+        budgie_translate_cell(st, buf, reg, off);
+    }
 }
 
-__inline static void budgie_translate_op_lopen(rd_buf_t **buf, unsigned char arg) {
+__inline static void budgie_translate_op_scan(struct budgie_x86_state *st, rd_buf_t **buf, int32_t arg) {
+    int32_t stride, mask;
+    unsigned char imm, back, cmp;
+    size_t jmp_pos;
+
+    /* the scan reads the tape, and rdx is scratch in here */
+    budgie_translate_dl_drop(st, buf);
+
+    /* the vector version works with the stride in bytes, and compares whole
+     * cells at a time */
+    back = arg < 0;
+    stride = back ? -arg : arg;
+    cmp = st->cell_sz == 1 ? 0x74 : st->cell_sz == 2 ? 0x75 : 0x76;
+    switch (stride <= 8 ? stride * st->cell_sz : 0) {
+    case 1: mask = 0; break;
+    case 2: mask = 0x5555; break;
+    case 4: mask = 0x1111; break;
+    case 8: mask = 0x0101; break;
+    default:
+        /* no vector version for this stride, so just step through the cells
+         *
+         *  jmp .test
+         * .loop:
+         *  add rsi, <stride> ; (or sub)
+         * .test:
+         *  cmp bl, [rsi] ; check if the cell is 0
+         *  jne .loop
+         */
+        rd_buffer_push(buf, c("\xEB\x00"), 2);
+        jmp_pos = (*buf)->len;
+        if (back) budgie_translate_op_prev(st, buf, stride);
+        else budgie_translate_op_next(st, buf, stride);
+        rd_buffer_data(*buf)[jmp_pos - 1] = (*buf)->len - jmp_pos;
+        imm = jmp_pos - (*buf)->len - budgie_translate_opc_sz(st) - 3;
+        budgie_translate_opc(st, buf, 0x3A, 0x3B);
+        rd_buffer_push(buf, c("\x1E" "\x75"), 2);
+        rd_buffer_push(buf, &imm, 1);
+        goto done;
+    }
+
+    /* look at 16 bytes at a time, starting with the aligned block the
+     * pointer is in. strides of 2, 4 and 8 bytes divide 16, so the cells they
+     * land on are at the same positions in every block, and a mask picks the
+     * first byte of each of those.
+     *
+     *  mov ecx, esi ; (only with a mask) shift the mask to the pointer's
+     *  and ecx, <stride - 1> ; position within the stride
+     *  mov edi, <mask>
+     *  shl edi, cl
+     */
+    if (mask) {
+        imm = stride * st->cell_sz - 1;
+        rd_buffer_push(buf, c("\x89\xF1" "\x83\xE1"), 4);
+        rd_buffer_push(buf, &imm, 1);
+        rd_buffer_push(buf, c("\xBF"), 1);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&mask), 4);
+        rd_buffer_push(buf, c("\xD3\xE7"), 2);
+    }
+
     /*
-     * cmp bh, [rsi] ; check if the cell is 0
-     * je $+0x00000000 ; jump to a different memory address if the cell is 0
+     *  mov ecx, esi ; position of the pointer in its block
+     *  and ecx, 15
+     *  and rsi, -16 ; start of the block
+     *  pxor xmm0, xmm0
+     *  xor ecx, 31 ; (only going back) 31 - position
+     *  movdqa xmm1, [rsi] ; which cells in the block are 0
+     *  pcmpeqb xmm1, xmm0 ; (pcmpeqw or pcmpeqd for wider cells)
+     *  pmovmskb eax, xmm1
+     *  and eax, edi ; (only with a mask) only the ones the stride lands on
+     *  shr eax, cl ; only the ones from the pointer onwards
+     *  shl eax, cl ; (shl and then shr going back, up to the pointer)
+     *  test eax, eax
+     *  jnz .found
      */
-    /* so technically there is a possibility to use a short jump instead
-     * of a near jump here, but that reaalllly complicates things (probably need
-     * 2 passes of the code) so i'll force near jumps always instead. */
-    /* for now the jump destination will be 0 */
-    rd_buffer_push(buf, c("\x3A\x3E" "\x0F\x84\x00\x00\x00\x00"), 8);
+    rd_buffer_push(buf, c("\x89\xF1" "\x83\xE1\x0F" "\x48\x83\xE6\xF0" "\x66\x0F\xEF\xC0"), 13);
+    if (back) rd_buffer_push(buf, c("\x83\xF1\x1F"), 3);
+    rd_buffer_push(buf, c("\x66\x0F\x6F\x0E" "\x66\x0F"), 6);
+    rd_buffer_push(buf, &cmp, 1);
+    rd_buffer_push(buf, c("\xC8" "\x66\x0F\xD7\xC1"), 5);
+    if (mask) rd_buffer_push(buf, c("\x21\xF8"), 2);
+    if (back) rd_buffer_push(buf, c("\xD3\xE0" "\xD3\xE8"), 4);
+    else rd_buffer_push(buf, c("\xD3\xE8" "\xD3\xE0"), 4);
+    imm = mask ? 22 : 20;
+    rd_buffer_push(buf, c("\x85\xC0" "\x75"), 3);
+    rd_buffer_push(buf, &imm, 1);
 
-    /* also push the location of the jump so we can overwrite later */
-    budgie_stack_push(loop_stack, (void *)(intptr_t)((*buf)->len));
+    /*
+     * .loop:
+     *  add rsi, 16 ; next block (or sub going back)
+     *  movdqa xmm1, [rsi]
+     *  pcmpeqb xmm1, xmm0
+     *  pmovmskb eax, xmm1
+     *  and eax, edi ; (only with a mask)
+     *  test eax, eax
+     *  jz .loop
+     */
+    if (back) rd_buffer_push(buf, c("\x48\x83\xEE\x10"), 4);
+    else rd_buffer_push(buf, c("\x48\x83\xC6\x10"), 4);
+    rd_buffer_push(buf, c("\x66\x0F\x6F\x0E" "\x66\x0F"), 6);
+    rd_buffer_push(buf, &cmp, 1);
+    rd_buffer_push(buf, c("\xC8" "\x66\x0F\xD7\xC1"), 5);
+    if (mask) rd_buffer_push(buf, c("\x21\xF8"), 2);
+    imm = -imm;
+    rd_buffer_push(buf, c("\x85\xC0" "\x74"), 3);
+    rd_buffer_push(buf, &imm, 1);
+
+    /*
+     * .found:
+     *  bsf eax, eax ; first 0 cell in the block (bsr for the last one)
+     *  add rsi, rax
+     */
+    if (back) rd_buffer_push(buf, c("\x0F\xBD\xC0"), 3);
+    else rd_buffer_push(buf, c("\x0F\xBC\xC0"), 3);
+    rd_buffer_push(buf, c("\x48\x01\xC6"), 3);
+
+done:
+    /* xor edx, edx ; the cell is 0 now, and dl can say so */
+    rd_buffer_push(buf, c("\x31\xD2"), 2);
+    st->dl_cached = 1;
 }
 
-__inline static void budgie_translate_op_lclos(rd_buf_t **buf, unsigned char arg) {
-    size_t lopen_pos;
-    int32_t diff;
+/* some runs of ops can be translated better together than one at a time.
+ * each idiom is a run of op types, and an emitter that translates the ops
+ * and returns 1, or returns 0 without emitting anything if it turns out not to
+ * apply to these ops after all. an idiom can't take more code than its ops
+ * would one at a time (see budgie_translate_op_max). bench/ngrams.sh shows
+ * which runs of ops are common enough to be worth adding here */
+struct budgie_translate_idiom {
+    enum budgie_op_type types[BUDGIE_IDIOM_MAX];
+    size_t n;
+    int (*emit)(struct budgie_x86_state *st, rd_buf_t **buf, const struct budgie_op *ops);
+};
+
+__inline static void budgie_translate_op_move(struct budgie_x86_state *st, rd_buf_t **buf,
+                                              const struct budgie_op *op) {
+    if (op->type == BOPT_P_NEXT) budgie_translate_op_next(st, buf, op->arg);
+    else budgie_translate_op_prev(st, buf, op->arg);
+}
+
+/* arithmetic on the current cell, then a move. the cell would only be loaded
+ * into dl to be written back right away, so add to it in memory instead.
+ * if dl has a change that hasn't been written back yet, it's just as well to
+ * add to dl and write that */
+static int budgie_translate_idiom_arith_move(struct budgie_x86_state *st, rd_buf_t **buf,
+                                             const struct budgie_op *ops) {
+    uint32_t imm;
+
+    if (ops[0].off != 0 || st->dl_dirty) return 0;
+    imm = (uint32_t)ops[0].arg;
+    if (ops[0].type == BOPT_D_DECR) imm = 0 - imm;
+    imm &= st->cell_mask;
+    st->dl_cached = 0;
+    if (imm) budgie_translate_add_cell(st, buf, imm, 0);
+    budgie_translate_op_move(st, buf, &ops[1]);
+    return 1;
+}
+
+/* setting the current cell, then a move. same as above, but whatever dl held
+ * is overwritten anyway */
+static int budgie_translate_idiom_set_move(struct budgie_x86_state *st, rd_buf_t **buf,
+                                           const struct budgie_op *ops) {
+    if (ops[0].off != 0) return 0;
+    st->dl_cached = st->dl_dirty = 0;
+    budgie_translate_set_cell(st, buf, ops[0].arg, 0);
+    budgie_translate_op_move(st, buf, &ops[1]);
+    return 1;
+}
+
+/* two `.` in a row, with full buffering: append both bytes, then check once
+ * if the buffer is full. the buffer has a byte to spare for when it only had
+ * room for one of them */
+static int budgie_translate_idiom_out_out(struct budgie_x86_state *st, rd_buf_t **buf,
+                                          const struct budgie_op *ops) {
+    struct budgie_x86_cold *flush;
+    int32_t sz;
+
+    if (!st->out_buffered || st->io_buffer != BIOB_FULL) return 0;
+
     /*
-     * cmp bh, [rsi] ; check if the cell is 0
-     * jne $+0x00000000 ; jump to a different memory address if the cell is 0
+     * mov al, <first cell>
+     * mov [r14+r13], al
+     * mov al, <second cell>
+     * mov [r14+r13+1], al
+     * add r13, 2
+     * cmp r13, BUDGIE_OUTBUF_SZ ; check if the buffer is full
+     * jae .flush
      */
-    /* so technically there is a possibility to use a short jump instead
-     * of a near jump here, but for consistency with lopen, i'll force near
-     * jumps always instead. */
-    rd_buffer_push(buf, c("\x3A\x3E" "\x0F\x85"), 4);
+    budgie_translate_out_load(st, buf, ops[0].off);
+    rd_buffer_push(buf, c("\x43\x88\x04\x2E"), 4);
+    budgie_translate_out_load(st, buf, ops[1].off);
+    sz = BUDGIE_OUTBUF_SZ;
+    rd_buffer_push(buf, c("\x43\x88\x44\x2E\x01" "\x49\x83\xC5\x02" "\x49\x81\xFD"), 12);
+    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&sz), 4);
+    flush = budgie_translate_cold(st, buf, 0x83, BCOLD_FLUSH);
+    flush->back = (*buf)->len;
+    return 1;
+}
 
-    /* get the location of the lopen */
-    lopen_pos = (size_t)(intptr_t)budgie_stack_pop(loop_stack);
+/* the idioms, tried in order at every op; longer ones have to come first */
+static const struct budgie_translate_idiom budgie_translate_idioms[] = {
+    { { BOPT_D_INCR, BOPT_P_NEXT }, 2, budgie_translate_idiom_arith_move },
+    { { BOPT_D_INCR, BOPT_P_PREV }, 2, budgie_translate_idiom_arith_move },
+    { { BOPT_D_DECR, BOPT_P_NEXT }, 2, budgie_translate_idiom_arith_move },
+    { { BOPT_D_DECR, BOPT_P_PREV }, 2, budgie_translate_idiom_arith_move },
+    { { BOPT_D_SET, BOPT_P_NEXT }, 2, budgie_translate_idiom_set_move },
+    { { BOPT_D_SET, BOPT_P_PREV }, 2, budgie_translate_idiom_set_move },
+    { { BOPT_D_OUT, BOPT_D_OUT }, 2, budgie_translate_idiom_out_out },
+    { { BOPT_NOOP }, 0, NULL }
+};
 
-    /* find the difference and make the jump go to the end of that place */
-    diff = lopen_pos - (*buf)->len - 4;
-    rd_buffer_push(buf, (unsigned char *)(intptr_t)(&diff), 4);
+/* translate the idiom that the ops in <win> (<n> of them) start with, if there
+ * is one. returns the number of ops translated, or 0 if none were */
+static size_t budgie_translate_idiom(struct budgie_x86_state *st, rd_buf_t **buf,
+                                     const struct budgie_op *win, size_t n) {
+    const struct budgie_translate_idiom *idiom;
+    size_t i;
 
-    /* also overwrite the old jump in the lopen that was blank */
-    *((int32_t *)(rd_buffer_data(*buf) + lopen_pos - 4)) = (*buf)->len - lopen_pos;
+    for (idiom = budgie_translate_idioms; idiom->n; idiom++) {
+        if (idiom->n > n) continue;
+        for (i = 0; i < idiom->n && win[i].type == idiom->types[i]; i++);
+        if (i == idiom->n && idiom->emit(st, buf, win)) return idiom->n;
+    }
+    return 0;
 }
 
-__inline static void budgie_translate_op_set(rd_buf_t **buf, unsigned char arg) {
-    /* movb [rsi], <number to set to> */
-    rd_buffer_push(buf, c("\xC6\x06"), 2);
-    rd_buffer_push(buf, &arg, 1);
+/* put the cold code jumped to so far here, after everything else, and point
+ * the jumps at it */
+static void budgie_translate_cold_code(struct budgie_x86_state *st, rd_buf_t **buf, int jit) {
+    struct budgie_x86_cold *cold;
+    size_t i, j;
+    int32_t diff;
+
+    for (i = 0; i < st->ncold; i++) {
+        cold = &st->cold[i];
+        for (j = 0; j < 2; j++) {
+            if (!cold->jump[j]) continue;
+            *((int32_t *)(rd_buffer_data(*buf) + cold->jump[j] - 4)) = (*buf)->len - cold->jump[j];
+        }
+
+        switch (cold->type) {
+        case BCOLD_FLUSH:
+            /* call flush */
+            budgie_translate_call(buf, st->flush_pos);
+            break;
+        case BCOLD_GETC:
+            /* lea rsi, [rsi+<offset>] ; getc reads into [rsi]
+             * call getc ; refill the buffer and read the next byte
+             * lea rsi, [rsi-<offset>] ; back to the current cell
+             */
+            budgie_translate_move(st, buf, cold->off);
+            budgie_translate_call(buf, st->getc_pos);
+            budgie_translate_move(st, buf, -cold->off);
+            break;
+        case BCOLD_TAPE_FAIL:
+            if (jit) {
+                /* pop rax ; the mapping that failed
+                 * mov eax, 1
+                 * pop r15
+                 * pop r14
+                 * pop r13
+                 * pop r12
+                 * pop rbp
+                 * pop rbx
+                 * ret
+                 */
+                rd_buffer_push(buf, c("\x58" "\xB8\x01\x00\x00\x00"
+                                      "\x41\x5F" "\x41\x5E" "\x41\x5D" "\x41\x5C" "\x5D" "\x5B" "\xC3"), 17);
+            } else {
+                /* mov edi, 1
+                 * mov eax, 60 ; (60 = exit)
+                 * syscall
+                 */
+                rd_buffer_push(buf, c("\xBF\x01\x00\x00\x00" "\xB8\x3C\x00\x00\x00" "\x0F\x05"), 12);
+            }
+            continue; /* there's no going back */
+        }
+
+        /* jmp $+0x00000000 ; back to where it was jumped to from */
+        diff = cold->back - ((*buf)->len + 5);
+        rd_buffer_push(buf, c("\xE9"), 1);
+        rd_buffer_push(buf, (unsigned char *)(intptr_t)(&diff), 4);
+    }
 }
 
-int budgie_translate_x86_64_linux(rd_buf_t *in, rd_buf_t **out) {
-    size_t i, ninstrs;
+int budgie_translate_x86_64_code(rd_buf_t *in, const struct budgie_options *opts, int jit,
+                                 rd_buf_t **out, rd_buf_t **out_data,
+                                 struct rd_elf_link_relocation *relocs, size_t *out_bss_size) {
+    size_t i, bss_size, jmp_pos, nrelocs, body_pos, nloops, tape_len, out_len, outbuf, reach, guard, len;
+    size_t code_max, win_sz[BUDGIE_IDIOM_MAX], n, j, used, step, counters, prof_len, done_js, ncold, cold_base;
+    int32_t sz;
     rd_buf_t *code, *data;
-    struct rd_elf_link_relocation relocs[2];
-    struct budgie_op *ops;
-    int rc;
+    struct budgie_op op, win[BUDGIE_IDIOM_MAX];
+    unsigned char *ops, header[BUDGIE_PROFILE_HEADER];
+    int rc, use_out, use_in, use_flush, hot;
+    long last;
+    struct budgie_x86_state state, *st;
 
     /* initialization */
-    code = rd_buffer_init();
-    loop_stack = budgie_stack_new();
-    ops = (struct budgie_op *)rd_buffer_data(in);
-    ninstrs = in->len / sizeof(struct budgie_op);
+    st = &state;
+    memset(st, 0, sizeof(*st));
+    st->io_buffer = opts->io_buffer;
+    st->cell_sz = opts->cell_size;
+    st->cell_mask = st->cell_sz == 4 ? 0xFFFFFFFF : ((uint32_t)1 << (8 * st->cell_sz)) - 1;
+    st->code_base = jit ? 0 : BUDGIE_CODE_START; /* the jit maps the code at the start of a page */
+    st->align_bytes = opts->align_bytes;
+    st->instrument = opts->instrument != NULL;
+    bss_size = opts->tape == BTAPE_STATIC ? opts->tape_size * st->cell_sz : 0;
+    ops = rd_buffer_data(in);
+    code = data = NULL;
+    rc = 0;
+
+    /* only emit the parts of the runtime that the program actually uses */
+    use_out = use_in = 0;
+    nloops = 0;
+    ncold = 1; /* the tape failing to map */
+    reach = 0; /* furthest away from a cell on the tape the program can get */
+    code_max = BUDGIE_RUNTIME_MAX;
+    for (i = 0; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        if (op.type <= BOPT_P_SCAN) code_max += budgie_translate_op_max[op.type];
+        if (op.type == BOPT_F_LOPEN && st->instrument) code_max += BUDGIE_COUNT_MAX;
+        if (budgie_translate_abs(op.off) > reach) reach = budgie_translate_abs(op.off);
+        if (budgie_translate_abs(op.src) > reach) reach = budgie_translate_abs(op.src);
+        if ((op.type == BOPT_P_NEXT || op.type == BOPT_P_PREV || op.type == BOPT_P_SCAN)
+                && budgie_translate_abs(op.arg) > reach) {
+            reach = budgie_translate_abs(op.arg);
+        }
+        if (op.type == BOPT_D_OUT || op.type == BOPT_D_IN) ncold++;
+        if (op.type == BOPT_D_OUT) use_out = 1;
+        else if (op.type == BOPT_D_IN) use_in = 1;
+        else if (op.type == BOPT_F_LOPEN && (size_t)op.arg >= nloops) nloops = op.arg + 1;
+    }
+
+    /* every loop starts out with short jumps, and each `.` and `,` can have
+     * some cold code */
+    st->loop_near = calloc(nloops + 1, 1);
+    st->loop_pos = calloc(nloops + 1, sizeof(*st->loop_pos));
+    st->loop_body = calloc(nloops + 1, sizeof(*st->loop_body));
+    st->loop_align = calloc(nloops + 1, 1);
+    st->cold = calloc(ncold, sizeof(*st->cold));
+    if (!st->loop_near || !st->loop_pos || !st->loop_body || !st->loop_align || !st->cold) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* pick the loops to align. a loop is innermost if the next bracket after
+     * its lopen is its own lclos */
+    for (i = 0, last = -1; i < in->len; ) {
+        i += budgie_op_decode(ops + i, &op);
+        if (op.type == BOPT_F_LOPEN) {
+            last = op.arg;
+            hot = opts->profile && budgie_profile_hot(opts->profile, op.arg);
+            if (hot && opts->stats) opts->stats->loops_hot++;
+            if (opts->align == BALIGN_ALL || (opts->align != BALIGN_NONE && hot)) st->loop_align[op.arg] = 1;
+        } else if (op.type == BOPT_F_LCLOS) {
+            if (op.arg == last && opts->align == BALIGN_INNER) st->loop_align[op.arg] = 1;
+            last = -1;
+        }
+    }
+    for (i = 0; i < nloops; i++) {
+        if (!st->loop_align[i]) continue;
+        code_max += st->align_bytes - 1;
+        if (opts->stats) opts->stats->loops_aligned++;
+    }
+
+    /* allocate code and data at their full size, so neither has to grow */
+    tape_len = opts->start ? opts->start->tape->len : 0;
+    out_len = opts->start ? opts->start->output->len : 0;
+    prof_len = st->instrument ? BUDGIE_PROFILE_HEADER + strlen(opts->instrument) + 1 : 0;
+    code = rd_buffer_initsz(code_max);
+    data = rd_buffer_initsz(tape_len + out_len + prof_len + 1);
+
+    /* each loop's counter is found at a 32 bit displacement */
+    if (st->instrument && nloops > 0x7FFFFFFF / 8) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    st->out_buffered = use_out && st->io_buffer != BIOB_NONE;
+
+    /* moves and offsets end up in bytes in 32 bit immediates and
+     * displacements, so with wider cells they have to still fit */
+    if (reach > 0x7FFFFFFF / st->cell_sz) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* the cells and output worked out at compile time go in data, in that
+     * order */
+    if (opts->start) {
+        rd_buffer_push(&data, rd_buffer_data(opts->start->tape), tape_len);
+        rd_buffer_push(&data, rd_buffer_data(opts->start->output), out_len);
+    }
+
+    /* then what an instrumented program writes before its counts, and the
+     * name of the file to write them to */
+    if (st->instrument) {
+        budgie_profile_header(budgie_profile_hash(in), nloops, header);
+        rd_buffer_push(&data, header, BUDGIE_PROFILE_HEADER);
+        rd_buffer_push(&data, c(opts->instrument), strlen(opts->instrument) + 1);
+    }
+    use_flush = st->out_buffered || out_len;
 
     /* preamble (same code for everything) */
 
-    /* TODO: remove development comments
-    pseudocode:
-
-    allocate enough memory for the program (maybe use bss??)
-    set rsi to the start of the memory (zeroed out)
-    clear r12
-    clear rbx
-    increment r12
-    set r13 to 0x3C (60)
-
-    rsp,rbp, rbx, r12, r13, r14, and r15 are protected
-
-    rsi is the pointer to the memory space
-    rdx is always 1
-    rdi is sometimes 1, othertimes 0 (copy it from r10 or r11)
-    0 = read (r10)
-    1 = write (r11)
-    60 = exit (r12)
-    
-    */
-
-    /* set rsi to the start of the memory (movabs rsi, 0x00)
-     * (will be relocated to start of bss segment later) */
-    rd_buffer_push(&code, c("\x48\xBE\x00\x00\x00\x00\x00\x00\x00\x00"), 10);
-    relocs[0].type = RELOC_BSS64;
-    relocs[0].target = 2;
-    relocs[0].src = 0; /* can customize where to start from here (allowing for 
-                        * moving the cell pointer backwards */
-    relocs[1].type = RELOC_NULL;
+    /* what the code keeps in registers from here on:
+     *  rsi: the cell pointer
+     *  dl: the current cell, when it's cached (dx or edx for wider cells)
+     *  rbx: 0, for sys_read and stdin
+     *  r12: 1, for sys_write and stdout
+     *  r13, r14: how full the output buffer is, and where it starts
+     *  rbp, r15: the next unread byte of the input buffer, and its end
+     *  r9: the loop counters, when instrumenting
+     */
+
+    if (jit) {
+        /* the registers the code uses that the caller expects to be kept
+         * push rbx
+         * push rbp
+         * push r12
+         * push r13
+         * push r14
+         * push r15
+         */
+        rd_buffer_push(&code, c("\x53" "\x55" "\x41\x54" "\x41\x55" "\x41\x56" "\x41\x57"), 10);
+    }
+
+    /* the guard pages have to be far enough out that nothing skips over
+     * them: a move that leaves the tape, then the furthest offset from there */
+    guard = 0;
+    if (opts->tape == BTAPE_MMAP) {
+        guard = budgie_translate_pages(2 * reach * st->cell_sz + 1);
+        budgie_translate_tape_map(st, &code, jit, opts->tape_size * st->cell_sz, guard,
+                                  BUDGIE_TAPE_START(opts) * st->cell_sz);
+    }
+
+    nrelocs = 0;
+    if (tape_len) {
+        /* start the cells off as they were left at compile time
+         * movabs rsi, 0x00 ; (will be relocated to the start of data)
+         * movabs rdi, 0x00 ; (will be relocated to the start of bss)
+         * mov rdi, rdx ; (or this, for a mapped tape)
+         * mov ecx, <number of cells>
+         * rep movsb
+         */
+        relocs[nrelocs].type = RELOC_DATA64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = 0;
+        rd_buffer_push(&code, c("\x48\xBE\x00\x00\x00\x00\x00\x00\x00\x00"), 10);
+        if (opts->tape == BTAPE_MMAP) {
+            rd_buffer_push(&code, c("\x48\x89\xD7"), 3);
+        } else {
+            relocs[nrelocs].type = RELOC_BSS64;
+            relocs[nrelocs].target = code->len + 2;
+            relocs[nrelocs++].src = 0;
+            rd_buffer_push(&code, c("\x48\xBF\x00\x00\x00\x00\x00\x00\x00\x00"), 10);
+        }
+        sz = tape_len;
+        rd_buffer_push(&code, c("\xB9"), 1);
+        rd_buffer_push(&code, (unsigned char *)(intptr_t)(&sz), 4);
+        rd_buffer_push(&code, c("\xF3\xA4"), 2);
+    }
+
+    /* set rsi to where the cell pointer starts */
+    len = opts->start ? opts->start->pos * st->cell_sz : 0;
+    if (opts->tape == BTAPE_MMAP) {
+        /* movabs rsi, <start>
+         * add rsi, rdx
+         */
+        rd_buffer_push(&code, c("\x48\xBE"), 2);
+        rd_buffer_push(&code, (unsigned char *)(intptr_t)(&len), 8);
+        rd_buffer_push(&code, c("\x48\x01\xD6"), 3);
+    } else {
+        /* movabs rsi, 0x00 ; (will be relocated into bss later) */
+        relocs[nrelocs].type = RELOC_BSS64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = len;
+        rd_buffer_push(&code, c("\x48\xBE\x00\x00\x00\x00\x00\x00\x00\x00"), 10);
+    }
 
     /* set r12 and rbx to the correct values */
     /* xor rbx, rbx
@@ -185,58 +1278,259 @@ int budgie_translate_x86_64_linux(rd_buf_t *in, rd_buf_t **out) {
      */
     rd_buffer_push(&code, c("\x48\x31\xDB" "\x4D\x31\xE4" "\x49\xFF\xC4"), 9);
 
-    /* translate each instruction */
-    /* TODO: remove development comments
-    pseudocode:
-
-    1. create stack
-    2. top of the stack is a single value, 0.
-    3. usually, when you add an instruction, push it to the data buffer
-        and also add its size to the top of the stack
-    4. if LOPEN is reached instead, push the usual code, but also push a new
-        0 to the top of the stack
-    5. if LCLOSE is reached instead, pop the top value of the stack. this
-        is the jump offset (in bytes) needed to get to the start of the loop.
-        push the usual code. also, add the popped value to the new top of the
-        stack.
-    6. at the end, the number of bytes written out will be in the top of the
-        stack.
-    */
-
-    for (i = 0; i < ninstrs; i++) {
-        /* translate each instruction */
-        switch (ops->type) {
-        case BOPT_P_NEXT:   budgie_translate_op_next(&code, ops->arg);  break;
-        case BOPT_P_PREV:   budgie_translate_op_prev(&code, ops->arg);  break;
-        case BOPT_D_INCR:   budgie_translate_op_incr(&code, ops->arg);  break;
-        case BOPT_D_DECR:   budgie_translate_op_decr(&code, ops->arg);  break;
-        case BOPT_D_OUT:    budgie_translate_op_out(&code, ops->arg);   break;
-        case BOPT_D_IN:     budgie_translate_op_in(&code, ops->arg);    break;
-        case BOPT_F_LOPEN:  budgie_translate_op_lopen(&code, ops->arg); break;
-        case BOPT_F_LCLOS:  budgie_translate_op_lclos(&code, ops->arg); break;
-        case BOPT_D_SET:    budgie_translate_op_set(&code, ops->arg);   break;
-        default: break;
+    /* and dl to the first cell
+     * movzx edx, byte [rsi] ; if it might not be 0 anymore
+     * (or movzx edx, word [rsi] or mov edx, [rsi] for wider cells)
+     * xor edx, edx ; otherwise
+     */
+    if (!tape_len) rd_buffer_push(&code, c("\x31\xD2"), 2);
+    else if (st->cell_sz == 1) rd_buffer_push(&code, c("\x0F\xB6\x16"), 3);
+    else if (st->cell_sz == 2) rd_buffer_push(&code, c("\x0F\xB7\x16"), 3);
+    else rd_buffer_push(&code, c("\x8B\x16"), 2);
+
+    /* the output buffer goes in bss after the cells */
+    outbuf = bss_size;
+    if (st->out_buffered) bss_size += BUDGIE_OUTBUF_SZ + 1; /* see budgie_translate_idiom_out_out */
+
+    if (use_in) {
+        /* the input buffer starts out empty (rbp == r15)
+         * xor ebp, ebp
+         * xor r15d, r15d
+         */
+        rd_buffer_push(&code, c("\x31\xED" "\x45\x31\xFF"), 5);
+    }
+
+    if (use_flush || use_in) {
+        /* the runtime routines go here, so jump over them (jmp $+0x00000000) */
+        rd_buffer_push(&code, c("\xE9\x00\x00\x00\x00"), 5);
+        jmp_pos = code->len;
+        if (use_flush) budgie_translate_rt_flush(st, &code);
+        if (use_in) {
+            budgie_translate_rt_getc(st, &code, opts->eof, &relocs[nrelocs++], bss_size);
+            bss_size += BUDGIE_INBUF_SZ;
         }
-        ops++;
+        *((int32_t *)(rd_buffer_data(code) + jmp_pos - 4)) = code->len - jmp_pos;
     }
 
+    if (out_len) {
+        /* print the output worked out at compile time, with the flush
+         * routine pointed at it instead of the output buffer
+         * movabs r14, 0x00 ; (will be relocated to the output in data)
+         * mov r13d, <number of bytes>
+         * call flush
+         */
+        relocs[nrelocs].type = RELOC_DATA64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = tape_len;
+        sz = out_len;
+        rd_buffer_push(&code, c("\x49\xBE\x00\x00\x00\x00\x00\x00\x00\x00" "\x41\xBD"), 12);
+        rd_buffer_push(&code, (unsigned char *)(intptr_t)(&sz), 4);
+        budgie_translate_call(&code, st->flush_pos);
+    }
+
+    if (st->out_buffered) {
+        /* set r14 to the output buffer (movabs r14, 0x00)
+         * xor r13d, r13d ; the buffer starts out empty
+         */
+        relocs[nrelocs].type = RELOC_BSS64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = outbuf;
+        rd_buffer_push(&code, c("\x49\xBE\x00\x00\x00\x00\x00\x00\x00\x00" "\x45\x31\xED"), 13);
+    }
+
+    counters = 0;
+    if (st->instrument) {
+        /* the loop counters go in bss last
+         * movabs r9, 0x00 ; (will be relocated to the counters)
+         */
+        counters = (bss_size + 7) / 8 * 8;
+        bss_size = counters + nloops * 8;
+        relocs[nrelocs].type = RELOC_BSS64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = counters;
+        rd_buffer_push(&code, c("\x49\xB9\x00\x00\x00\x00\x00\x00\x00\x00"), 10);
+    }
+
+    /* translate each instruction */
+    /* loops use short jumps until they turn out to be too big for them.
+     * making one near makes the code longer, which can push other loops over
+     * the limit too, so keep emitting the code until nothing changes */
+    body_pos = code->len;
+    cold_base = st->ncold;
+    memset(win_sz, 0, sizeof(win_sz)); /* short windows at the end never fill it */
+    do {
+        code->len = body_pos;
+        st->ncold = cold_base;
+        st->relax = 0;
+        st->zf_cell = 0;
+        st->dl_cached = 1; /* the cell starts out as 0, and so does dl */
+        st->dl_dirty = 0;
+
+        for (i = 0; i < in->len; i += step) {
+            /* look at the next few ops, and translate them together if they
+             * make an idiom, or else just the first one */
+            for (n = 0, j = i; n < BUDGIE_IDIOM_MAX && j < in->len; n++) {
+                win_sz[n] = budgie_op_decode(ops + j, &win[n]);
+                j += win_sz[n];
+            }
+            op = win[0];
+            used = budgie_translate_idiom(st, &code, win, n);
+            if (!used) {
+                switch (op.type) {
+                case BOPT_P_NEXT:   budgie_translate_op_next(st, &code, op.arg);  break;
+                case BOPT_P_PREV:   budgie_translate_op_prev(st, &code, op.arg);  break;
+                case BOPT_D_INCR:   budgie_translate_op_incr(st, &code, op.arg, op.off); break;
+                case BOPT_D_DECR:   budgie_translate_op_decr(st, &code, op.arg, op.off); break;
+                case BOPT_D_OUT:    budgie_translate_op_out(st, &code, op.arg, op.off); break;
+                case BOPT_D_IN:     budgie_translate_op_in(st, &code, op.arg, op.off); break;
+                case BOPT_F_LOPEN:  budgie_translate_op_lopen(st, &code, op.arg); break;
+                case BOPT_F_LCLOS:  budgie_translate_op_lclos(st, &code, op.arg); break;
+                case BOPT_D_SET:    budgie_translate_op_set(st, &code, op.arg, op.off); break;
+                case BOPT_D_MULA:   budgie_translate_op_mula(st, &code, op.arg, op.off, op.src); break;
+                case BOPT_P_SCAN:   budgie_translate_op_scan(st, &code, op.arg); break;
+                default: break;
+                }
+                used = 1;
+            }
+            for (step = j = 0; j < used; j++) step += win_sz[j];
+            op = win[used - 1];
+
+            /* arithmetic on the current cell leaves ZF telling whether it is
+             * 0, and so do loop brackets (both ways out of one have just
+             * tested the cell, unless lopen counted an iteration after),
+             * and scans, which end with xor edx, edx. anything else may have
+             * changed it */
+            switch (op.type) {
+            case BOPT_D_INCR:
+            case BOPT_D_DECR:   st->zf_cell = op.off == 0 && ((uint32_t)op.arg & st->cell_mask) != 0; break;
+            case BOPT_D_MULA:   st->zf_cell = op.off == 0; break;
+            case BOPT_P_SCAN:   st->zf_cell = 1; break;
+            case BOPT_F_LOPEN:  if (st->instrument) st->zf_cell = 0; break;
+            case BOPT_F_LCLOS:  break;
+            default:            st->zf_cell = 0; break;
+            }
+        }
+    } while (st->relax);
+
     /* epilogue */
-    /* exit with code 0 */
-    /* mov rax, 0x3c ; (60 = exit)
-     * mov rdi, rbx ; rbx is set to 0 and rdi = 0 = exit success
-     * syscall
-     */
-    rd_buffer_push(&code, c("\x48\xC7\xC0\x3C\x00\x00\x00" "\x48\x89\xDF" "\x0F\x05"), 12);
+    /* write out whatever is still buffered */
+    if (st->out_buffered) budgie_translate_call(&code, st->flush_pos);
 
-    /* no data for this; only bss */
-    data = rd_buffer_init();
+    if (st->instrument) {
+        /* write the counts out, after the header. if the file can't be
+         * opened there's no profile, but the program still succeeds
+         * movabs r10, 0x00 ; (will be relocated to the header in data)
+         * lea rdi, [r10+24] ; the file name comes right after it
+         * mov esi, 0x241 ; O_WRONLY | O_CREAT | O_TRUNC
+         * mov edx, 0644
+         * mov eax, 2 ; (2 = open)
+         * syscall
+         * test eax, eax
+         * js .done
+         */
+        relocs[nrelocs].type = RELOC_DATA64;
+        relocs[nrelocs].target = code->len + 2;
+        relocs[nrelocs++].src = tape_len + out_len;
+        rd_buffer_push(&code, c("\x49\xBA\x00\x00\x00\x00\x00\x00\x00\x00" "\x49\x8D\x7A\x18"
+                                "\xBE\x41\x02\x00\x00" "\xBA\xA4\x01\x00\x00" "\xB8\x02\x00\x00\x00"
+                                "\x0F\x05" "\x85\xC0" "\x78\x00"), 35);
+        done_js = code->len;
+
+        /* mov edi, eax
+         * mov rsi, r10
+         * mov edx, <size of the header>
+         * mov eax, 1 ; (1 = write)
+         * syscall
+         * mov rsi, r9
+         * mov edx, <size of the counters>
+         * mov eax, 1
+         * syscall
+         * mov eax, 3 ; (3 = close)
+         * syscall
+         * .done:
+         */
+        sz = nloops * 8;
+        rd_buffer_push(&code, c("\x89\xC7" "\x4C\x89\xD6" "\xBA\x18\x00\x00\x00" "\xB8\x01\x00\x00\x00"
+                                "\x0F\x05" "\x4C\x89\xCE" "\xBA"), 21);
+        rd_buffer_push(&code, (unsigned char *)(intptr_t)(&sz), 4);
+        rd_buffer_push(&code, c("\xB8\x01\x00\x00\x00" "\x0F\x05" "\xB8\x03\x00\x00\x00" "\x0F\x05"), 14);
+        rd_buffer_data(code)[done_js - 1] = code->len - done_js;
+    }
+    relocs[nrelocs].type = RELOC_NULL;
+
+    if (jit && opts->tape == BTAPE_MMAP) {
+        /* unmap the tape
+         * pop rdi
+         * movabs rsi, <length>
+         * mov eax, 11 ; (11 = munmap)
+         * syscall
+         */
+        len = 2 * guard + budgie_translate_pages(opts->tape_size * st->cell_sz);
+        rd_buffer_push(&code, c("\x5F" "\x48\xBE"), 3);
+        rd_buffer_push(&code, (unsigned char *)(intptr_t)(&len), 8);
+        rd_buffer_push(&code, c("\xB8\x0B\x00\x00\x00" "\x0F\x05"), 7);
+    }
+
+    if (jit) {
+        /* give the caller its registers back and return 0
+         * xor eax, eax
+         * pop r15
+         * pop r14
+         * pop r13
+         * pop r12
+         * pop rbp
+         * pop rbx
+         * ret
+         */
+        rd_buffer_push(&code, c("\x31\xC0" "\x41\x5F" "\x41\x5E" "\x41\x5D" "\x41\x5C" "\x5D" "\x5B" "\xC3"), 13);
+    } else {
+        /* exit with code 0 */
+        /* mov rax, 0x3c ; (60 = exit)
+         * mov rdi, rbx ; rbx is set to 0 and rdi = 0 = exit success
+         * syscall
+         */
+        rd_buffer_push(&code, c("\x48\xC7\xC0\x3C\x00\x00\x00" "\x48\x89\xDF" "\x0F\x05"), 12);
+    }
+
+    /* and then everything that hardly ever runs */
+    budgie_translate_cold_code(st, &code, jit);
+
+    if (opts->stats) opts->stats->code_bytes = code->len;
+    *out_bss_size = bss_size;
+
+cleanup:
+    if (rc) {
+        rd_buffer_free(code);
+        rd_buffer_free(data);
+        code = data = NULL;
+    }
+    *out = code;
+    *out_data = data;
+    free(st->loop_near);
+    free(st->loop_pos);
+    free(st->loop_body);
+    free(st->loop_align);
+    free(st->cold);
+    return rc;
+}
+
+int budgie_translate_x86_64_linux(rd_buf_t *in, const struct budgie_options *opts, rd_buf_t **out) {
+    rd_buf_t *code, *data;
+    struct rd_elf_link_relocation relocs[BUDGIE_X86_64_RELOCS + 1];
+    size_t bss_size;
+    int rc;
+
+    rc = budgie_translate_x86_64_code(in, opts, 0, &code, &data, relocs, &bss_size);
+    if (rc) return rc;
 
     /* final linking */
-    rc = rd_elf_link64(RD_ELFHDR_MACHINE_X86_64, code, data, BUDGIE_MAX_CELLS, relocs, out);
+    /* with the tape mapped and no i/o, nothing goes in bss, but the linker
+     * can't make an empty one */
+    if (!bss_size) bss_size = 1;
+    rc = rd_elf_link64(RD_ELFHDR_MACHINE_X86_64, code, data, bss_size, relocs, out);
 
     /* done */
-    rd_buffer_free(code);
     rd_buffer_free(data);
-    budgie_stack_destroy(loop_stack);
+    rd_buffer_free(code);
     return rc;
 }
@@ -0,0 +1,247 @@
+/* this file runs the start of a program at compile time, so that work that
+ * doesn't depend on the input (like building up constants to print) is done
+ * once by budgie instead of every time the program runs */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <rudolph/buffer.h>
+#include "ir.h"
+#include "options.h"
+#include "peval.h"
+#include "stats.h"
+
+/* the program as it's being run */
+struct budgie_peval_run {
+    unsigned char *ops; /* the oplist */
+    struct budgie_loops *loops; /* and its loops */
+    uint32_t *tape; /* the cells */
+    uint32_t mask; /* the bits a cell holds */
+    size_t cells; /* how many there are */
+    size_t hi; /* one past the highest cell used so far */
+    size_t pos; /* the cell pointer */
+    size_t steps; /* ops left to run */
+    rd_buf_t *output; /* what was printed so far */
+};
+
+/* offset of the op after the one at <i> */
+__inline static size_t budgie_peval_next(const unsigned char *ops, size_t i) {
+    struct budgie_op op;
+
+    return i + budgie_op_decode(ops + i, &op);
+}
+
+/* the cell <off> away from the pointer, or NULL if that's off the tape */
+static uint32_t *budgie_peval_cell(struct budgie_peval_run *r, long off) {
+    long i;
+
+    i = (long)r->pos + off;
+    if (i < 0 || (size_t)i >= r->cells) return NULL;
+    if ((size_t)i >= r->hi) r->hi = i + 1;
+    return r->tape + i;
+}
+
+/* move the pointer by <d>. returns 1 if that would go off the tape */
+static int budgie_peval_move(struct budgie_peval_run *r, long d) {
+    if (!budgie_peval_cell(r, d)) return 1;
+    r->pos += d;
+    return 0;
+}
+
+/* run the ops from <i> up to <end>. returns 0 if they all ran, or 1 if one
+ * couldn't (it needs input, goes off the tape, or there are no steps left),
+ * in which case whatever ran before it has to be undone */
+static int budgie_peval_block(struct budgie_peval_run *r, size_t i, size_t end) {
+    struct budgie_op op;
+    uint32_t *cell, *src;
+    unsigned char c;
+    size_t n;
+
+    while (i < end) {
+        if (!r->steps) return 1;
+        r->steps--;
+
+        n = budgie_op_decode(r->ops + i, &op);
+        switch (op.type) {
+        case BOPT_P_NEXT:
+            if (budgie_peval_move(r, op.arg)) return 1;
+            break;
+        case BOPT_P_PREV:
+            if (budgie_peval_move(r, -(long)op.arg)) return 1;
+            break;
+        case BOPT_D_INCR:
+        case BOPT_D_DECR:
+        case BOPT_D_SET:
+            cell = budgie_peval_cell(r, op.off);
+            if (!cell) return 1;
+            if (op.type == BOPT_D_INCR) *cell += (uint32_t)op.arg;
+            else if (op.type == BOPT_D_DECR) *cell -= (uint32_t)op.arg;
+            else *cell = (uint32_t)op.arg;
+            *cell &= r->mask;
+            break;
+        case BOPT_D_MULA:
+            cell = budgie_peval_cell(r, op.off);
+            src = budgie_peval_cell(r, op.src);
+            if (!cell || !src) return 1;
+            *cell = (*cell + *src * (uint32_t)op.arg) & r->mask;
+            break;
+        case BOPT_D_OUT:
+            cell = budgie_peval_cell(r, op.off);
+            if (!cell || r->output->len >= BUDGIE_PEVAL_MAX_OUTPUT) return 1;
+            c = (unsigned char)*cell;
+            rd_buffer_push(&r->output, &c, 1);
+            break;
+        case BOPT_D_IN:
+            /* this is as far as it goes */
+            return 1;
+        case BOPT_F_LOPEN:
+            /* skip the loop, or go into it */
+            if (!r->tape[r->pos]) {
+                i = budgie_peval_next(r->ops, r->loops->loop[op.arg].close);
+                continue;
+            }
+            break;
+        case BOPT_F_LCLOS:
+            /* go around again, or leave the loop */
+            if (r->tape[r->pos]) {
+                i = budgie_peval_next(r->ops, r->loops->loop[op.arg].open);
+                continue;
+            }
+            break;
+        case BOPT_P_SCAN:
+            while (r->tape[r->pos]) {
+                if (!r->steps) return 1;
+                r->steps--;
+                if (budgie_peval_move(r, op.arg)) return 1;
+            }
+            break;
+        default: break;
+        }
+        i += n;
+    }
+
+    return 0;
+}
+
+int budgie_peval(rd_buf_t **in, struct budgie_loops *loops, size_t steps, size_t cells,
+                 int cell_size, struct budgie_peval *out, struct budgie_stats *stats) {
+    struct budgie_peval_run r;
+    struct budgie_loops out_loops;
+    struct budgie_op op;
+    rd_buf_t *rest;
+    uint32_t *snap;
+    unsigned char bytes[4];
+    size_t i, end, snap_hi, snap_pos, snap_len, len, j;
+    int k;
+    long loop;
+    int rc;
+
+    out->tape = NULL;
+    out->output = NULL;
+    out->pos = 0;
+    rest = NULL;
+    budgie_loops_init(&out_loops);
+    rc = 0;
+
+    r.ops = rd_buffer_data(*in);
+    r.loops = loops;
+    r.cells = cells < BUDGIE_PEVAL_CELLS ? cells : BUDGIE_PEVAL_CELLS;
+    r.mask = cell_size >= 4 ? 0xFFFFFFFF : ((uint32_t)1 << (8 * cell_size)) - 1;
+    r.tape = calloc(r.cells + 1, sizeof(*r.tape));
+    r.hi = r.pos = 0;
+    r.steps = steps;
+    r.output = rd_buffer_init();
+    snap = malloc((r.cells + 1) * sizeof(*snap));
+    if (!r.tape || !snap) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* run one op at a time, or one whole loop at a time */
+    for (i = 0; i < (*in)->len; i = end) {
+        budgie_op_decode(r.ops + i, &op);
+        if (op.type == BOPT_F_LOPEN) {
+            end = budgie_peval_next(r.ops, loops->loop[op.arg].close);
+
+            /* a loop might get stopped partway through, so remember how
+             * things were before it. copying the tape costs steps too, so a
+             * big tape can't make this take forever */
+            len = r.hi / 64 + 1;
+            if (r.steps < len) break;
+            r.steps -= len;
+            memcpy(snap, r.tape, r.hi * sizeof(*snap));
+            snap_hi = r.hi;
+            snap_pos = r.pos;
+            snap_len = r.output->len;
+
+            if (budgie_peval_block(&r, i, end)) {
+                memcpy(r.tape, snap, snap_hi * sizeof(*snap));
+                memset(r.tape + snap_hi, 0, (r.hi - snap_hi) * sizeof(*snap));
+                r.hi = snap_hi;
+                r.pos = snap_pos;
+                r.output->len = snap_len;
+                break;
+            }
+        } else {
+            /* a single op stops before changing anything */
+            end = budgie_peval_next(r.ops, i);
+            if (budgie_peval_block(&r, i, end)) break;
+        }
+    }
+
+    /* hand over the tape up to the last cell that isn't 0, laid out the way
+     * the program keeps it: <cell_size> little-endian bytes a cell */
+    for (len = r.hi; len > 0 && !r.tape[len - 1]; len--);
+    out->tape = rd_buffer_initsz(len * cell_size + 1);
+    for (j = 0; j < len; j++) {
+        for (k = 0; k < cell_size; k++) bytes[k] = (unsigned char)(r.tape[j] >> (8 * k));
+        rd_buffer_push(&out->tape, bytes, cell_size);
+    }
+    out->pos = r.pos;
+    out->output = r.output;
+    r.output = NULL;
+    if (stats) {
+        stats->peval_steps = steps - r.steps;
+        stats->peval_cells = len;
+        stats->peval_output = out->output->len;
+    }
+    if (i == 0) goto cleanup;
+
+    /* the rest of the program, from where that stopped */
+    rest = rd_buffer_initsz((*in)->len - i + 1);
+    for (; i < (*in)->len; ) {
+        i += budgie_op_decode(r.ops + i, &op);
+        if (op.type == BOPT_F_LOPEN || op.type == BOPT_F_LCLOS) {
+            if (op.type == BOPT_F_LOPEN) loop = budgie_loops_open(&out_loops, rest->len);
+            else loop = budgie_loops_close(&out_loops, rest->len);
+            if (loop < 0) {
+                rc = -__LINE__;
+                goto cleanup;
+            }
+            op.arg = loop;
+        }
+        budgie_op_push(&rest, &op);
+    }
+
+    rd_buffer_free(*in);
+    budgie_loops_free(loops);
+    *in = rest;
+    *loops = out_loops;
+    rest = NULL;
+    budgie_loops_init(&out_loops);
+
+cleanup:
+    if (rc) budgie_peval_free(out);
+    rd_buffer_free(rest);
+    rd_buffer_free(r.output);
+    budgie_loops_free(&out_loops);
+    free(r.tape);
+    free(snap);
+    return rc;
+}
+
+void budgie_peval_free(struct budgie_peval *peval) {
+    rd_buffer_free(peval->tape);
+    rd_buffer_free(peval->output);
+    peval->tape = peval->output = NULL;
+    peval->pos = 0;
+}
@@ -0,0 +1,104 @@
+/* this file reads the loop counts an instrumented program leaves behind, so
+ * the next compile of it knows which loops are worth spending code on */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <rudolph/buffer.h>
+#include "profile.h"
+
+/* 64 bit FNV-1a, spelled out so it doesn't need 64 bit constants */
+#define BUDGIE_FNV_BASIS ((uint64_t)0xCBF29CE4 << 32 | 0x84222325)
+#define BUDGIE_FNV_PRIME ((uint64_t)1 << 40 | 0x1B3)
+
+__inline static void budgie_profile_put64(unsigned char *out, uint64_t v) {
+    int i;
+
+    for (i = 0; i < 8; i++) out[i] = (unsigned char)(v >> (8 * i));
+}
+
+__inline static uint64_t budgie_profile_get64(const unsigned char *in) {
+    uint64_t v;
+    int i;
+
+    for (v = 0, i = 7; i >= 0; i--) v = v << 8 | in[i];
+    return v;
+}
+
+uint64_t budgie_profile_hash(rd_buf_t *ir) {
+    const unsigned char *p;
+    uint64_t hash;
+    size_t i;
+
+    p = rd_buffer_data(ir);
+    hash = BUDGIE_FNV_BASIS;
+    for (i = 0; i < ir->len; i++) hash = (hash ^ p[i]) * BUDGIE_FNV_PRIME;
+    return hash;
+}
+
+void budgie_profile_header(uint64_t hash, size_t nloops, unsigned char out[BUDGIE_PROFILE_HEADER]) {
+    memcpy(out, BUDGIE_PROFILE_MAGIC, 8);
+    budgie_profile_put64(out + 8, hash);
+    budgie_profile_put64(out + 16, nloops);
+}
+
+int budgie_profile_read(const char *name, struct budgie_profile *out) {
+    unsigned char header[BUDGIE_PROFILE_HEADER], count[8];
+    uint64_t nloops;
+    size_t i;
+    FILE *fp;
+    int rc;
+
+    out->counts = NULL;
+    out->nloops = 0;
+    out->total = 0;
+    rc = 0;
+
+    fp = fopen(name, "rb");
+    if (!fp) return -__LINE__;
+
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)
+            || memcmp(header, BUDGIE_PROFILE_MAGIC, 8)) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    out->hash = budgie_profile_get64(header + 8);
+    nloops = budgie_profile_get64(header + 16);
+    if (nloops > ((size_t)-1) / sizeof(*out->counts) - 1) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    out->counts = calloc(nloops + 1, sizeof(*out->counts));
+    if (!out->counts) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    out->nloops = nloops;
+    for (i = 0; i < out->nloops; i++) {
+        /* a program killed partway through never wrote its counts */
+        if (fread(count, 1, sizeof(count), fp) != sizeof(count)) {
+            rc = -__LINE__;
+            goto cleanup;
+        }
+        out->counts[i] = budgie_profile_get64(count);
+        out->total += out->counts[i];
+    }
+
+cleanup:
+    if (rc) budgie_profile_free(out);
+    fclose(fp);
+    return rc;
+}
+
+int budgie_profile_hot(const struct budgie_profile *profile, size_t loop) {
+    if (loop >= profile->nloops || !profile->counts[loop]) return 0;
+    return profile->counts[loop] >= profile->total / BUDGIE_PROFILE_HOT;
+}
+
+void budgie_profile_free(struct budgie_profile *profile) {
+    free(profile->counts);
+    profile->counts = NULL;
+    profile->nloops = 0;
+    profile->total = 0;
+}
@@ -0,0 +1,73 @@
+/* this file runs programs right away in budgie's own process, using the same
+ * code the x86_64 linux backend puts in executables */
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <rudolph/buffer.h>
+#include <rudolph/elf_link.h>
+#include "options.h"
+#include "x86_64_linux.h"
+
+int budgie_run_x86_64_linux(rd_buf_t *in, const struct budgie_options *opts) {
+    rd_buf_t *code, *data;
+    struct rd_elf_link_relocation relocs[BUDGIE_X86_64_RELOCS + 1], *reloc;
+    size_t bss_size;
+    unsigned char *bss, *map;
+    uint64_t addr;
+    int (*entry)(void);
+    int rc;
+
+    bss = NULL;
+    map = MAP_FAILED;
+
+    /* same code as an executable would have, but returning at the end */
+    rc = budgie_translate_x86_64_code(in, opts, 1, &code, &data, relocs, &bss_size);
+    if (rc) return rc;
+
+    /* the cells and i/o buffers, zeroed out like bss would be */
+    bss = calloc(bss_size + 1, 1);
+    if (!bss) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* copy the code somewhere it can be patched */
+    map = mmap(NULL, code->len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+    memcpy(map, rd_buffer_data(code), code->len);
+
+    /* do the linker's job, pointing the code at the memory instead of bss,
+     * and at the data where it already is (it's only ever read) */
+    for (reloc = relocs; reloc->type != RELOC_NULL; reloc++) {
+        if (reloc->type == RELOC_BSS64) addr = (uint64_t)(uintptr_t)(bss + reloc->src);
+        else if (reloc->type == RELOC_DATA64) addr = (uint64_t)(uintptr_t)(rd_buffer_data(data) + reloc->src);
+        else {
+            rc = -__LINE__;
+            goto cleanup;
+        }
+        memcpy(map + reloc->target, &addr, sizeof(addr));
+    }
+
+    /* and then make it executable instead of writable */
+    if (mprotect(map, code->len, PROT_READ | PROT_EXEC)) {
+        rc = -__LINE__;
+        goto cleanup;
+    }
+
+    /* there's no portable way to turn a data pointer into a function
+     * pointer, so copy it over instead */
+    memcpy(&entry, &map, sizeof(entry));
+    if (entry()) rc = -__LINE__; /* couldn't map the tape */
+
+cleanup:
+    if (map != MAP_FAILED) munmap(map, code->len);
+    free(bss);
+    rd_buffer_free(code);
+    rd_buffer_free(data);
+    return rc;
+}
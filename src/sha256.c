@@ -0,0 +1,111 @@
+/* this file is a plain SHA-256 (FIPS 180-4), for naming things by what's in
+ * them */
+#include <string.h>
+#include <stdint.h>
+#include "sha256.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t budgie_sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* mix one 64 byte block into the state */
+static void budgie_sha256_block(struct budgie_sha256 *ctx, const unsigned char *p) {
+    uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (; i < 64; i++) {
+        w[i] = (ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10)) + w[i - 7]
+             + (ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3)) + w[i - 16];
+    }
+
+    a = ctx->h[0];
+    b = ctx->h[1];
+    c = ctx->h[2];
+    d = ctx->h[3];
+    e = ctx->h[4];
+    f = ctx->h[5];
+    g = ctx->h[6];
+    h = ctx->h[7];
+    for (i = 0; i < 64; i++) {
+        t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + budgie_sha256_k[i] + w[i];
+        t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    ctx->h[0] += a;
+    ctx->h[1] += b;
+    ctx->h[2] += c;
+    ctx->h[3] += d;
+    ctx->h[4] += e;
+    ctx->h[5] += f;
+    ctx->h[6] += g;
+    ctx->h[7] += h;
+}
+
+void budgie_sha256_init(struct budgie_sha256 *ctx) {
+    ctx->h[0] = 0x6A09E667;
+    ctx->h[1] = 0xBB67AE85;
+    ctx->h[2] = 0x3C6EF372;
+    ctx->h[3] = 0xA54FF53A;
+    ctx->h[4] = 0x510E527F;
+    ctx->h[5] = 0x9B05688C;
+    ctx->h[6] = 0x1F83D9AB;
+    ctx->h[7] = 0x5BE0CD19;
+    ctx->len = 0;
+    ctx->bits = 0;
+}
+
+void budgie_sha256_update(struct budgie_sha256 *ctx, const void *data, size_t len) {
+    const unsigned char *p;
+    size_t n;
+
+    p = data;
+    ctx->bits += (uint64_t)len * 8;
+
+    while (len) {
+        n = 64 - ctx->len < len ? 64 - ctx->len : len;
+        memcpy(ctx->block + ctx->len, p, n);
+        ctx->len += n;
+        p += n;
+        len -= n;
+        if (ctx->len == 64) {
+            budgie_sha256_block(ctx, ctx->block);
+            ctx->len = 0;
+        }
+    }
+}
+
+void budgie_sha256_final(struct budgie_sha256 *ctx, unsigned char out[BUDGIE_SHA256_LEN]) {
+    unsigned char pad[72];
+    uint64_t bits;
+    size_t n;
+    int i;
+
+    /* a 1 bit, 0s up to 8 bytes short of a block, then the length in bits */
+    bits = ctx->bits;
+    n = ctx->len < 56 ? 56 - ctx->len : 120 - ctx->len;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (i = 0; i < 8; i++) pad[n + i] = (unsigned char)(bits >> (56 - 8 * i));
+    budgie_sha256_update(ctx, pad, n + 8);
+
+    for (i = 0; i < 32; i++) out[i] = (unsigned char)(ctx->h[i / 4] >> (24 - 8 * (i % 4)));
+}
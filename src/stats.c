@@ -0,0 +1,192 @@
+/* this file keeps track of numbers about a compile for --stats */
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+#define BUDGIE_NGRAM_TYPES (BOPT_P_SCAN + 1) /* op types an n-gram can have */
+
+static const char *phase_names[_BSP_MAX] = { "parse", "optimize", "translate", "write", "run" };
+
+/* current wall clock and cpu time in seconds, to take differences of */
+static void budgie_stats_now(double *wall, double *cpu) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *wall = ts.tv_sec + ts.tv_nsec / 1e9;
+    *cpu = (double)clock() / CLOCKS_PER_SEC;
+}
+
+void budgie_stats_init(struct budgie_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    budgie_stats_mark(stats);
+}
+
+void budgie_stats_mark(struct budgie_stats *stats) {
+    budgie_stats_now(&stats->mark_wall, &stats->mark_cpu);
+}
+
+void budgie_stats_phase(struct budgie_stats *stats, enum budgie_stats_phase phase) {
+    double wall, cpu;
+
+    budgie_stats_now(&wall, &cpu);
+    stats->wall[phase] += wall - stats->mark_wall;
+    stats->cpu[phase] += cpu - stats->mark_cpu;
+    stats->mark_wall = wall;
+    stats->mark_cpu = cpu;
+}
+
+void budgie_stats_count(rd_buf_t *ops, size_t counts[_BOPT_MAX + 1]) {
+    struct budgie_op op;
+    size_t i;
+
+    for (i = 0; i <= _BOPT_MAX; i++) counts[i] = 0;
+    for (i = 0; i < ops->len; ) {
+        i += budgie_op_decode(rd_buffer_data(ops) + i, &op);
+        counts[op.type]++;
+    }
+}
+
+static size_t budgie_stats_total(const size_t counts[_BOPT_MAX + 1]) {
+    size_t i, n;
+
+    for (i = n = 0; i <= _BOPT_MAX; i++) n += counts[i];
+    return n;
+}
+
+static void budgie_stats_print_text(const struct budgie_stats *stats, FILE *fp) {
+    int i;
+
+    fprintf(fp, "%-12s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+    for (i = 0; i < _BSP_MAX; i++) {
+        fprintf(fp, "%-12s %12.3f %12.3f\n", phase_names[i], stats->wall[i] * 1e3, stats->cpu[i] * 1e3);
+    }
+
+    fprintf(fp, "\ninput: %lu bytes\n", (unsigned long)stats->input_bytes);
+    fprintf(fp, "ir: %lu ops in %lu bytes before optimizing, %lu ops in %lu bytes after\n",
+        (unsigned long)budgie_stats_total(stats->ops_before), (unsigned long)stats->ir_bytes_before,
+        (unsigned long)budgie_stats_total(stats->ops_after), (unsigned long)stats->ir_bytes_after);
+
+    fprintf(fp, "\n%-12s %12s %12s\n", "op", "before", "after");
+    for (i = 0; i <= _BOPT_MAX; i++) {
+        if (!budgie_op_name(i) || (!stats->ops_before[i] && !stats->ops_after[i])) continue;
+        fprintf(fp, "%-12s %12lu %12lu\n", budgie_op_name(i),
+            (unsigned long)stats->ops_before[i], (unsigned long)stats->ops_after[i]);
+    }
+
+    fprintf(fp, "\nloops: %lu scan, %lu multiplication, %lu clear, %lu dead, %lu hot, %lu aligned\n",
+        (unsigned long)stats->loops_scan, (unsigned long)stats->loops_mula, (unsigned long)stats->loops_clear,
+        (unsigned long)stats->loops_dead, (unsigned long)stats->loops_hot,
+        (unsigned long)stats->loops_aligned);
+    fprintf(fp, "folded: %lu ops\n", (unsigned long)stats->ops_folded);
+    fprintf(fp, "compile time: %lu ops run, %lu cells and %lu bytes of output worked out\n",
+        (unsigned long)stats->peval_steps, (unsigned long)stats->peval_cells, (unsigned long)stats->peval_output);
+    fprintf(fp, "code: %lu bytes, executable: %lu bytes\n",
+        (unsigned long)stats->code_bytes, (unsigned long)stats->output_bytes);
+}
+
+static void budgie_stats_print_counts(const size_t counts[_BOPT_MAX + 1], FILE *fp) {
+    int i, first;
+
+    fprintf(fp, "{");
+    for (i = 0, first = 1; i <= _BOPT_MAX; i++) {
+        if (!budgie_op_name(i)) continue;
+        fprintf(fp, "%s\"%s\":%lu", first ? "" : ",", budgie_op_name(i), (unsigned long)counts[i]);
+        first = 0;
+    }
+    fprintf(fp, "}");
+}
+
+static void budgie_stats_print_json(const struct budgie_stats *stats, FILE *fp) {
+    int i;
+
+    fprintf(fp, "{\"phases\":{");
+    for (i = 0; i < _BSP_MAX; i++) {
+        fprintf(fp, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", i ? "," : "",
+            phase_names[i], stats->wall[i] * 1e3, stats->cpu[i] * 1e3);
+    }
+
+    fprintf(fp, "},\"input_bytes\":%lu,\"ir\":{\"before\":{\"ops\":%lu,\"bytes\":%lu,\"counts\":",
+        (unsigned long)stats->input_bytes, (unsigned long)budgie_stats_total(stats->ops_before),
+        (unsigned long)stats->ir_bytes_before);
+    budgie_stats_print_counts(stats->ops_before, fp);
+    fprintf(fp, "},\"after\":{\"ops\":%lu,\"bytes\":%lu,\"counts\":",
+        (unsigned long)budgie_stats_total(stats->ops_after), (unsigned long)stats->ir_bytes_after);
+    budgie_stats_print_counts(stats->ops_after, fp);
+
+    fprintf(fp, "}},\"loops\":{\"scan\":%lu,\"mula\":%lu,\"clear\":%lu,\"dead\":%lu,\"hot\":%lu,\"aligned\":%lu},"
+        "\"folded\":%lu",
+        (unsigned long)stats->loops_scan, (unsigned long)stats->loops_mula, (unsigned long)stats->loops_clear,
+        (unsigned long)stats->loops_dead, (unsigned long)stats->loops_hot,
+        (unsigned long)stats->loops_aligned, (unsigned long)stats->ops_folded);
+    fprintf(fp, ",\"peval\":{\"steps\":%lu,\"cells\":%lu,\"output\":%lu}",
+        (unsigned long)stats->peval_steps, (unsigned long)stats->peval_cells, (unsigned long)stats->peval_output);
+    fprintf(fp, ",\"code_bytes\":%lu,\"output_bytes\":%lu}\n",
+        (unsigned long)stats->code_bytes, (unsigned long)stats->output_bytes);
+}
+
+void budgie_stats_print(const struct budgie_stats *stats, int json, FILE *fp) {
+    if (json) budgie_stats_print_json(stats, fp);
+    else budgie_stats_print_text(stats, fp);
+}
+
+/* how many times one n-gram came up, for sorting */
+struct budgie_ngram {
+    size_t count;
+    size_t index; /* the op types, as the digits of a number in base BUDGIE_NGRAM_TYPES */
+};
+
+/* most common first, then in order of the op types */
+static int budgie_stats_ngram_cmp(const void *a, const void *b) {
+    const struct budgie_ngram *x = a, *y = b;
+
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+int budgie_stats_ngrams(rd_buf_t *ops, int n, FILE *fp) {
+    struct budgie_op op;
+    struct budgie_ngram *sorted;
+    size_t *counts;
+    size_t total, i, idx, seen, nsorted, digit;
+    int k;
+
+    if (n < 1 || n > BUDGIE_NGRAM_MAX) return -__LINE__;
+    for (k = 0, total = 1; k < n; k++) total *= BUDGIE_NGRAM_TYPES;
+    counts = calloc(total, sizeof(*counts));
+    if (!counts) return -__LINE__;
+
+    /* slide a window of the last <n> op types along the oplist */
+    for (i = idx = seen = 0; i < ops->len; ) {
+        i += budgie_op_decode(rd_buffer_data(ops) + i, &op);
+        if (op.type >= BUDGIE_NGRAM_TYPES || op.type == BOPT_NOOP) continue;
+        idx = (idx * BUDGIE_NGRAM_TYPES + op.type) % total;
+        if (++seen >= (size_t)n) counts[idx]++;
+    }
+
+    for (i = nsorted = 0; i < total; i++) nsorted += counts[i] != 0;
+    sorted = malloc((nsorted + 1) * sizeof(*sorted));
+    if (!sorted) {
+        free(counts);
+        return -__LINE__;
+    }
+    for (i = nsorted = 0; i < total; i++) {
+        if (!counts[i]) continue;
+        sorted[nsorted].count = counts[i];
+        sorted[nsorted++].index = i;
+    }
+    qsort(sorted, nsorted, sizeof(*sorted), budgie_stats_ngram_cmp);
+
+    for (i = 0; i < nsorted; i++) {
+        fprintf(fp, "%lu", (unsigned long)sorted[i].count);
+        for (k = n - 1, digit = total / BUDGIE_NGRAM_TYPES; k >= 0; k--, digit /= BUDGIE_NGRAM_TYPES) {
+            fprintf(fp, " %s", budgie_op_name(sorted[i].index / digit % BUDGIE_NGRAM_TYPES));
+        }
+        fprintf(fp, "\n");
+    }
+
+    free(sorted);
+    free(counts);
+    return 0;
+}